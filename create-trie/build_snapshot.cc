@@ -0,0 +1,55 @@
+#include "create_suffix.h"
+#include "flat_trie.h"
+#include "huffman.h"
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// builds the global suffix trie from the corpus (preProsCorpus0 .. 55) and
+// writes it as a snapshot file, which main maps at startup instead of
+// rebuilding the trie, with the Huffman codes of the chars of the corpus
+//   build_snapshot [file]           writes the snapshot (default SuffixTrie.bin)
+//   build_snapshot -verify [file]   checks the header and checksum of a snapshot
+//   -chars file                     writes the codes to file (default CharCodes.bin)
+//   -nocontext                      one code for all chars, not one per previous char
+int main(int argc, char ** argv){
+	string file = "SuffixTrie.bin";
+	string charsFile = "CharCodes.bin";
+	bool verify = false;
+	bool contexts = true;
+	for(int i = 1; i < argc; i++){
+		string arg = argv[i];
+		if(arg == "-verify") verify = true;
+		else if(arg == "-chars" && i + 1 < argc) charsFile = argv[++i];
+		else if(arg == "-nocontext") contexts = false;
+		else file = arg;
+	}
+
+	flat_trie Global;
+	if(verify){
+		if(!Global.load(file, true)){
+			cerr << file << ": not a valid snapshot" << endl;
+			return 1;
+		}
+		cout << file << ": " << Global.size() << " nodes, checksum " << hex << Global.checksum() << endl;
+		return 0;
+	}
+
+	char_counts counts;
+	readCorpus(&Global, &counts);
+	if(!Global.save(file)){
+		cerr << "could not write " << file << endl;
+		return 1;
+	}
+	cout << "wrote " << file << ": " << Global.size() << " nodes, checksum " << hex << Global.checksum() << endl;
+
+	huffman_table codes;
+	codes.build(counts, contexts);
+	if(!codes.save(charsFile)){
+		cerr << "could not write " << charsFile << endl;
+		return 1;
+	}
+	cout << "wrote " << charsFile << ": " << (contexts ? "a code per previous char" : "one code") << ", checksum " << codes.checksum() << endl;
+	return 0;
+}
@@ -9,10 +9,11 @@ using namespace std;
 bool COMMENTS = false;
 
 
-// given a corpus in a 
-trie * readCorpus(){
-	trie * Global = new trie;
-
+// adds all word-prefixes of every phrase of the corpus
+// (files preProsCorpus0 .. preProsCorpus55) to Global, and counts the chars
+// of every phrase in counts (if not NULL)
+template <class T>
+static void insertCorpus(T * Global, char_counts * counts){
 string name = "preProsCorpus";
 for (int k = 0; k  <= 55; k++){
 	ostringstream thisName;
@@ -48,9 +49,21 @@ for (int k = 0; k  <= 55; k++){
 				if(COMMENTS) cout << "\"" << item << "\"" << endl;
 				Global->insert(item);
 			} // if
+			if(counts && i == len) counts->add(item);
 		} // for
 	} // while
 
 }
+}
+
+// given a corpus in a 
+trie * readCorpus(char_counts * counts){
+	trie * Global = new trie;
+	insertCorpus(Global, counts);
 	return Global;
 }
+
+// same as above, building a flat trie directly
+void readCorpus(flat_trie * Global, char_counts * counts){
+	insertCorpus(Global, counts);
+}
@@ -1,7 +1,12 @@
 #ifndef __CREATE_SUFFIX__
 #define __CREATE_SUFFIX__
 #include "suffix_trie.h"
+#include "flat_trie.h"
+#include "huffman.h"
 
-trie * readCorpus();
+// counts the chars of the phrases in counts too, if it is not NULL
+trie * readCorpus(char_counts * counts = NULL);
+
+void readCorpus(flat_trie * Global, char_counts * counts = NULL);
 
 #endif
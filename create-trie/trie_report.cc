@@ -0,0 +1,25 @@
+#include "create_suffix.h"
+#include "suffix_trie.h"
+#include "flat_trie.h"
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+// builds the global suffix trie from the corpus and compares the memory
+// taken by the pointer trie and the flat trie
+int main(){
+	trie * Global = readCorpus();
+	flat_trie Flat(*Global);
+
+	cout << "nodes: " << Global->size() << endl;
+	cout << fixed << setprecision(1);
+	cout << "pointer trie: " << Global->memory_usage() / 1048576.0 << " MB ("
+		<< sizeof(trie_node) << " bytes per node, plus one allocation per node)" << endl;
+	cout << "flat trie   : " << Flat.memory_usage() / 1048576.0 << " MB ("
+		<< sizeof(flat_trie_node) << " bytes per node, one allocation)" << endl;
+	cout << "ratio       : " << 1.0 * Global->memory_usage() / Flat.memory_usage() << "x" << endl;
+
+	delete Global;
+	return 0;
+}
@@ -0,0 +1,180 @@
+#include "flat_trie.h"
+#include "trie_search.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <queue>
+
+using namespace std;
+
+// picks a word group of the trie by walking down from the root, choosing
+// each child with a probability proportional to its count
+string random_group(const flat_trie &t, unsigned int len) {
+	string r;
+	flat_trie::node_type current = t.root_node();
+	while (r.size() < len) {
+		unsigned long long total = 0;
+		for (unsigned int i = 0; i < 27; i ++)
+			if (t.node_child(current, i)) total += t.node_count(t.node_child(current, i));
+		if (!total) break;
+		unsigned long long pick = ((unsigned long long) rand() * RAND_MAX + rand()) % total;
+		for (unsigned int i = 0; i < 27; i ++) {
+			flat_trie::node_type next = t.node_child(current, i);
+			if (!next) continue;
+			if (pick < t.node_count(next)) {
+				r += index_char(i);
+				current = next;
+				break;
+			}
+			pick -= t.node_count(next);
+		}
+	}
+	return string(r.rbegin(), r.rend());
+}
+
+// a flat trie counting the children looked up, to compare the node visits
+struct counted_trie {
+	const flat_trie &t;
+	mutable unsigned long long visits;
+	counted_trie(const flat_trie &t): t(t), visits(0) {}
+	typedef flat_trie::node_type node_type;
+	node_type root_node() const { return t.root_node(); }
+	unsigned long long node_count(node_type n) const { return t.node_count(n); }
+	node_type node_child(node_type n, unsigned int i) const { visits ++; return t.node_child(n, i); }
+};
+
+// all the ways to reveal 1 to 4 chars of a group of len chars, as the encoder tries them
+vector <queue <unsigned int> > all_reveals(unsigned int len) {
+	vector <queue <unsigned int> > dontcares;
+	for (unsigned int mask = 1; mask < (1u << len); mask ++) {
+		if (__builtin_popcount(mask) > 4) continue;
+		queue <unsigned int> dontcare;
+		for (unsigned int i = 0; i < len; i ++) if (!(mask >> i & 1)) dontcare.push(i);
+		dontcares.push_back(dontcare);
+	}
+	return dontcares;
+}
+
+// compares the set-based rank (trie_rank) with the counting rank (get_rank),
+// and the set-based word (trie_word) with get_word, which searches best-first
+// for the first ranks and collects the matches without a set otherwise,
+// on random word groups of a snapshot, with 1 to 4 revealed chars, and
+// get_rank for every way to reveal 1 to 4 chars with the batched get_ranks
+//   bench_rank [snapshot] [queries]
+int main(int argc, char ** argv) {
+	string file = argc > 1 ? argv[1] : "SuffixTrie.bin";
+	int queries = argc > 2 ? atoi(argv[2]) : 2000;
+
+	flat_trie t;
+	if (!t.load(file)) {
+		cerr << file << ": not a valid snapshot (see create-trie/build_snapshot)" << endl;
+		return 1;
+	}
+
+	srand(1);
+	vector <string> groups;
+	vector <queue <unsigned int> > dontcares;
+	while ((int) groups.size() < queries) {
+		string s = random_group(t, 4 + rand() % 20);
+		if (s.size() < 2 || s[0] == ' ') continue;
+		// reveals q random chars, all the others are don't cares
+		unsigned int q = 1 + rand() % 4;
+		vector <bool> revealed(s.size(), false);
+		for (unsigned int i = 0; i < q; i ++) revealed[rand() % s.size()] = true;
+		queue <unsigned int> dontcare;
+		for (unsigned int i = 0; i < s.size(); i ++) if (!revealed[i]) dontcare.push(i);
+		groups.push_back(s);
+		dontcares.push_back(dontcare);
+	}
+
+	vector <long long> old_rank(queries), new_rank(queries);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < queries; i ++) old_rank[i] = trie_rank(t, groups[i], dontcares[i], false);
+	chrono::steady_clock::time_point middle = chrono::steady_clock::now();
+	for (int i = 0; i < queries; i ++) new_rank[i] = t.get_rank(groups[i], dontcares[i]);
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	int wrong = 0;
+	for (int i = 0; i < queries; i ++) if (old_rank[i] != new_rank[i]) wrong ++;
+
+	double old_ms = chrono::duration <double, milli> (middle - start).count();
+	double new_ms = chrono::duration <double, milli> (end - middle).count();
+	cout << queries << " queries" << endl;
+	cout << "set rank     : " << old_ms << " ms (" << 1000 * old_ms / queries << " us / query)" << endl;
+	cout << "counting rank: " << new_ms << " ms (" << 1000 * new_ms / queries << " us / query)" << endl;
+	cout << "speedup      : " << old_ms / new_ms << "x, " << wrong << " different ranks" << endl;
+
+	// the decoder's side: the word at each rank, set-based (trie_word) and get_word
+	int wrong_words = 0;
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < queries; i ++) if (trie_word(t, groups[i], dontcares[i], new_rank[i], false) != groups[i]) wrong_words ++;
+	middle = chrono::steady_clock::now();
+	for (int i = 0; i < queries; i ++) if (t.get_word(groups[i], dontcares[i], new_rank[i]) != groups[i]) wrong_words ++;
+	end = chrono::steady_clock::now();
+
+	old_ms = chrono::duration <double, milli> (middle - start).count();
+	new_ms = chrono::duration <double, milli> (end - middle).count();
+	cout << "set word     : " << old_ms << " ms (" << 1000 * old_ms / queries << " us / query)" << endl;
+	cout << "get_word     : " << new_ms << " ms (" << 1000 * new_ms / queries << " us / query)" << endl;
+	cout << "speedup      : " << old_ms / new_ms << "x, " << wrong_words << " wrong words" << endl;
+
+	// get_word at the most frequent match, while the set-based search always
+	// builds every match
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < queries; i ++) trie_word(t, groups[i], dontcares[i], 0, false);
+	middle = chrono::steady_clock::now();
+	for (int i = 0; i < queries; i ++) t.get_word(groups[i], dontcares[i], 0);
+	end = chrono::steady_clock::now();
+
+	old_ms = chrono::duration <double, milli> (middle - start).count();
+	new_ms = chrono::duration <double, milli> (end - middle).count();
+	cout << "set word, rank 0   : " << old_ms << " ms (" << 1000 * old_ms / queries << " us / query)" << endl;
+	cout << "get_word, rank 0   : " << new_ms << " ms (" << 1000 * new_ms / queries << " us / query)" << endl;
+
+	// the two searches behind get_word by rank: best-first stops early at the
+	// first ranks, collecting all the matches costs the same at any rank
+	cout << "rank : set / best-first / collect (us / query)" << endl;
+	for (unsigned long long rank = 0; rank <= 256; rank = rank ? rank * 4 : 1) {
+		double set_ms = 0, select_ms = 0, collect_ms = 0;
+		for (int i = 0; i < queries; i ++) {
+			chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+			string word = trie_word(t, groups[i], dontcares[i], rank, false);
+			chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+			if (trie_select_word(t, groups[i], dontcares[i], rank, false) != word) wrong_words ++;
+			chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+			if (trie_collect_word(t, groups[i], dontcares[i], rank, false) != word) wrong_words ++;
+			chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+			set_ms += chrono::duration <double, milli> (t1 - t0).count();
+			select_ms += chrono::duration <double, milli> (t2 - t1).count();
+			collect_ms += chrono::duration <double, milli> (t3 - t2).count();
+		}
+		cout << rank << " : " << 1000 * set_ms / queries << " / " << 1000 * select_ms / queries << " / " << 1000 * collect_ms / queries << endl;
+	}
+
+	// every reveal of short groups, one get_rank each or all of them with get_ranks
+	int batches = queries / 50 + 1, wrong_batch = 0;
+	counted_trie one(t), all(t);
+	double one_ms = 0, all_ms = 0;
+	for (int i = 0; i < batches; i ++) {
+		string s;
+		while (s.size() < 4 || s.size() > 12 || s[0] == ' ') s = random_group(t, 4 + rand() % 9);
+		vector <queue <unsigned int> > reveals = all_reveals(s.size());
+		vector <long long> ranks(reveals.size());
+		start = chrono::steady_clock::now();
+		for (unsigned int m = 0; m < reveals.size(); m ++) ranks[m] = trie_count_rank(one, s, reveals[m], false);
+		middle = chrono::steady_clock::now();
+		vector <long long> batch = trie_count_ranks(all, s, reveals, false);
+		end = chrono::steady_clock::now();
+		if (batch != ranks) wrong_batch ++;
+		one_ms += chrono::duration <double, milli> (middle - start).count();
+		all_ms += chrono::duration <double, milli> (end - middle).count();
+	}
+	cout << batches << " groups, every reveal of 1 to 4 chars" << endl;
+	cout << "get_rank each : " << one_ms << " ms, " << one.visits << " children looked up" << endl;
+	cout << "get_ranks     : " << all_ms << " ms, " << all.visits << " children looked up" << endl;
+	cout << "speedup       : " << one_ms / all_ms << "x, " << wrong_batch << " different batches" << endl;
+	return wrong != 0 || wrong_words != 0 || wrong_batch != 0;
+}
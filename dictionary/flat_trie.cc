@@ -0,0 +1,216 @@
+#include "flat_trie.h"
+#include "trie_search.h"
+
+#include <utility>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// FNV-1a over the node array, one 64-bit word at a time
+unsigned long long flat_trie_checksum(const flat_trie_node* nodes, unsigned long long n) {
+	const unsigned long long* word = (const unsigned long long*) nodes;
+	unsigned long long words = n * sizeof(flat_trie_node) / sizeof(unsigned long long);
+	unsigned long long h = 14695981039346656037ULL;
+	for (unsigned long long i = 0; i < words; i ++) {
+		h ^= word[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+flat_trie::flat_trie(): mapped(NULL), mapped_size(0), garbage(0) {
+	flat_trie_node root = {0, 0, 0};
+	nodes.push_back(root);
+	base = &nodes[0];
+	length = nodes.size();
+}
+
+// copies the pointer trie, breadth-first
+flat_trie::flat_trie(const trie &t): mapped(NULL), mapped_size(0), garbage(0) {
+	flat_trie_node empty = {0, 0, 0};
+	nodes.push_back(empty);
+
+	std::queue <std::pair <trie::node_type, unsigned int> > q;
+	if (t.root_node()) q.push(std::make_pair(t.root_node(), 0));
+	while (!q.empty()) {
+		trie::node_type current = q.front().first;
+		unsigned int idx = q.front().second;
+		q.pop();
+		nodes[idx].count = t.node_count(current);
+		nodes[idx].first = nodes.size();
+		for (unsigned int i = 0; i < 27; i ++) {
+			if (!t.node_child(current, i)) continue;
+			nodes[idx].mask |= 1u << i;
+			q.push(std::make_pair(t.node_child(current, i), nodes.size()));
+			nodes.push_back(empty);
+		}
+	}
+	base = &nodes[0];
+	length = nodes.size();
+}
+
+flat_trie::~flat_trie() { _unmap(); }
+
+void flat_trie::_unmap() {
+	if (mapped) munmap(mapped, mapped_size);
+	mapped = NULL;
+	mapped_size = 0;
+}
+
+// adds an empty child for char index idx to current, and returns its index
+unsigned int flat_trie::_add_child(unsigned int current, unsigned int idx) {
+	flat_trie_node empty = {0, 0, 0};
+	unsigned int mask = nodes[current].mask;
+	unsigned int k = __builtin_popcount(mask);
+	unsigned int pos = __builtin_popcount(mask & ((1u << idx) - 1));
+	unsigned int first = nodes[current].first;
+
+	if (k && first + k == nodes.size()) {
+		// the block of children is at the end of the array, so it grows in place
+		nodes.push_back(empty);
+	} else {
+		// moves the block to the end of the array; its old slots become garbage
+		unsigned int moved = nodes.size();
+		nodes.resize(moved + k + 1);
+		for (unsigned int i = 0; i < k; i ++) nodes[moved + i] = nodes[first + i];
+		garbage += k;
+		first = moved;
+		nodes[current].first = first;
+	}
+
+	// opens the slot for the new child, keeping the block in char order
+	for (unsigned int i = first + k; i > first + pos; i --) nodes[i] = nodes[i - 1];
+	nodes[first + pos] = empty;
+	nodes[current].mask = mask | 1u << idx;
+	base = &nodes[0];
+	length = nodes.size();
+	return first + pos;
+}
+
+void flat_trie::insert(const std::string &s) {
+	// a mapped snapshot is read-only: takes a private copy first
+	if (mapped) {
+		nodes.assign(base, base + length);
+		_unmap();
+		base = &nodes[0];
+	}
+	unsigned int current = 0;
+	nodes[current].count ++;
+	for (std::string::const_reverse_iterator c = s.rbegin(); c != s.rend(); c ++) {
+		unsigned int idx = char_index(*c);
+		unsigned int next = node_child(current, idx);
+		if (!next) next = _add_child(current, idx);
+		nodes[next].count ++;
+		current = next;
+	}
+}
+
+void flat_trie::compact() {
+	if (!garbage) return;
+	std::vector <flat_trie_node> packed;
+	packed.reserve(size());
+	packed.push_back(nodes[0]);
+
+	// old index of every node in packed
+	std::queue <std::pair <unsigned int, unsigned int> > q;
+	q.push(std::make_pair(0, 0));
+	while (!q.empty()) {
+		unsigned int old = q.front().first;
+		unsigned int idx = q.front().second;
+		q.pop();
+		unsigned int k = __builtin_popcount(nodes[old].mask);
+		packed[idx].first = packed.size();
+		for (unsigned int i = 0; i < k; i ++) {
+			q.push(std::make_pair(nodes[old].first + i, packed.size()));
+			packed.push_back(nodes[nodes[old].first + i]);
+		}
+	}
+	nodes.swap(packed);
+	garbage = 0;
+	base = &nodes[0];
+	length = nodes.size();
+}
+
+bool flat_trie::save(const std::string &path) {
+	compact();
+
+	flat_trie_header header;
+	memset(&header, 0, sizeof(header));
+	strncpy(header.magic, FLAT_TRIE_MAGIC, sizeof(header.magic));
+	header.version = FLAT_TRIE_VERSION;
+	header.byte_order = 0x01020304;
+	header.node_size = sizeof(flat_trie_node);
+	header.nodes = length;
+	header.checksum = checksum();
+
+	FILE* out = fopen(path.c_str(), "wb");
+	if (!out) return false;
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+		&& fwrite(base, sizeof(flat_trie_node), length, out) == length;
+	return fclose(out) == 0 && ok;
+}
+
+bool flat_trie::load(const std::string &path, bool verify) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (unsigned long long) st.st_size < sizeof(flat_trie_header)) {
+		close(fd);
+		return false;
+	}
+	void* file = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (file == MAP_FAILED) return false;
+
+	// checks the header: a snapshot from another version or another kind of host is rejected
+	const flat_trie_header* header = (const flat_trie_header*) file;
+	const flat_trie_node* first = (const flat_trie_node*) (header + 1);
+	bool ok = strncmp(header->magic, FLAT_TRIE_MAGIC, sizeof(header->magic)) == 0
+		&& header->version == FLAT_TRIE_VERSION
+		&& header->byte_order == 0x01020304
+		&& header->node_size == sizeof(flat_trie_node)
+		&& header->nodes > 0
+		&& sizeof(flat_trie_header) + header->nodes * sizeof(flat_trie_node) == (unsigned long long) st.st_size;
+	if (ok && verify) ok = flat_trie_checksum(first, header->nodes) == header->checksum;
+	if (!ok) {
+		munmap(file, st.st_size);
+		return false;
+	}
+
+	_unmap();
+	std::vector <flat_trie_node>().swap(nodes);
+	mapped = file;
+	mapped_size = st.st_size;
+	base = first;
+	length = header->nodes;
+	garbage = 0;
+	return true;
+}
+
+unsigned long long flat_trie::checksum() const {
+	if (mapped) return ((const flat_trie_header*) mapped)->checksum;
+	return flat_trie_checksum(base, length);
+}
+
+bool flat_trie::approx_match(std::string s, const unsigned int max_mismatch) const {
+	return trie_approx_match(*this, s, max_mismatch);
+}
+
+long long flat_trie::get_rank(std::string s, std::queue <unsigned int> dontcare, bool usedLast) const {
+	return trie_count_rank(*this, s, dontcare, usedLast);
+}
+
+std::vector <long long> flat_trie::get_ranks(std::string s, const std::vector <std::queue <unsigned int> > &dontcares, bool usedLast) const {
+	return trie_count_ranks(*this, s, dontcares, usedLast);
+}
+
+std::string flat_trie::get_word(std::string s, std::queue <unsigned int> dontcare, unsigned long long rank, bool usedLast) const {
+	return trie_find_word(*this, s, dontcare, rank, usedLast);
+}
+
+unsigned long long flat_trie::size() const { return length - garbage; }
+
+unsigned long long flat_trie::memory_usage() const { return length * sizeof(flat_trie_node); }
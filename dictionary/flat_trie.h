@@ -0,0 +1,88 @@
+#ifndef __FLAT_TRIE__
+#define __FLAT_TRIE__
+
+#include "suffix_trie.h"
+
+#include <string>
+#include <queue>
+#include <vector>
+
+// a trie node without pointers: bit i of mask is set if the node has a child for
+// char index i, and the children are stored next to each other in the node array,
+// starting at first, in char order (so only existing children take a slot)
+struct flat_trie_node {
+	unsigned long long count;
+	unsigned int mask;
+	unsigned int first;
+};
+
+// snapshot file: this header followed by the node array, breadth-first
+#define FLAT_TRIE_MAGIC "SFXTRIE"
+#define FLAT_TRIE_VERSION 1
+
+struct flat_trie_header {
+	char magic[8];
+	unsigned int version;
+	unsigned int byte_order;	// 0x01020304 as written by the host that saved it
+	unsigned int node_size;
+	unsigned int reserved;
+	unsigned long long nodes;
+	unsigned long long checksum;	// of the node array, see flat_trie_checksum
+};
+
+unsigned long long flat_trie_checksum(const flat_trie_node* nodes, unsigned long long n);
+
+// same trie as the pointer trie in suffix_trie.h, with all the nodes in one
+// contiguous array and 32-bit child indices; node 0 is the root.
+// The array is either owned, or a snapshot file mapped read-only by load()
+class flat_trie {
+	private:
+		std::vector <flat_trie_node> nodes;
+		// the node array in use: nodes, or the mapped snapshot
+		const flat_trie_node* base;
+		unsigned long long length;
+		// the mapped snapshot file (header included), if any
+		void* mapped;
+		unsigned long long mapped_size;
+		// slots left behind when a child block had to be moved to grow
+		unsigned long long garbage;
+		unsigned int _add_child(unsigned int current, unsigned int idx);
+		void _unmap();
+		flat_trie(const flat_trie &);
+		flat_trie & operator = (const flat_trie &);
+	public:
+		flat_trie();
+		flat_trie(const trie &t);
+		~flat_trie();
+		void insert(const std::string &s);
+		bool approx_match(std::string s, const unsigned int max_mismatch) const;
+		long long get_rank(std::string s, std::queue <unsigned int> revealed, bool usedLast = false) const;
+		std::vector <long long> get_ranks(std::string s, const std::vector <std::queue <unsigned int> > &revealed, bool usedLast = false) const;
+		std::string get_word(std::string s, const std::queue <unsigned int> revealed, unsigned long long rank, bool usedLast = false) const;
+		// relays the nodes out breadth-first, dropping the garbage slots
+		void compact();
+
+		// writes a snapshot of the trie (compacting it first)
+		bool save(const std::string &path);
+		// maps the snapshot at path, which is then queried in place; the node
+		// checksum is only checked (reading the whole file) if verify is set
+		bool load(const std::string &path, bool verify = false);
+		bool is_mapped() const { return mapped != NULL; }
+		unsigned long long checksum() const;
+
+		// node access for the searches in trie_search.h (0 is never a child)
+		typedef unsigned int node_type;
+		node_type root_node() const { return 0; }
+		unsigned long long node_count(node_type n) const { return base[n].count; }
+		node_type node_child(node_type n, unsigned int i) const {
+			unsigned int mask = base[n].mask;
+			if (!(mask >> i & 1)) return 0;
+			return base[n].first + __builtin_popcount(mask & ((1u << i) - 1));
+		}
+
+		// number of nodes, and the bytes they take
+		unsigned long long size() const;
+		unsigned long long memory_usage() const;
+};
+
+#endif
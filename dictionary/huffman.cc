@@ -0,0 +1,154 @@
+#include "huffman.h"
+
+#include <algorithm>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+unsigned int huffman_symbol(char c) {
+	if (c >= 'a' && c <= 'z') return c - 'a' + 1;
+	if (c == ' ') return 27;
+	if (c == '.') return 28;
+	return 0;
+}
+
+char huffman_char(unsigned int symbol) {
+	if (symbol >= 1 && symbol <= 26) return 'a' + symbol - 1;
+	if (symbol == 27) return ' ';
+	if (symbol == 28) return '.';
+	return '\0';
+}
+
+char_counts::char_counts() {
+	memset(count, 0, sizeof(count));
+}
+
+void char_counts::add(const std::string &phrase) {
+	char prev = ' ';
+	for (std::string::const_iterator c = phrase.begin(); c != phrase.end(); c ++) {
+		unsigned int s = huffman_symbol(*c);
+		count[0][s] ++;
+		count[1 + huffman_symbol(prev)][s] ++;
+		prev = *c;
+	}
+}
+
+// the Huffman code lengths for weights, merging the two lightest trees until one is left
+static void code_lengths(const std::vector <unsigned long long> &weight, unsigned char* lengths) {
+	unsigned int n = weight.size();
+	// trees[i]: (weight, the symbols in it)
+	std::vector <std::pair <unsigned long long, std::vector <unsigned int> > > trees;
+	for (unsigned int s = 0; s < n; s ++) {
+		lengths[s] = 0;
+		trees.push_back(std::make_pair(weight[s], std::vector <unsigned int> (1, s)));
+	}
+	while (trees.size() > 1) {
+		// the lightest two, the first on ties so the lengths do not depend on the sort
+		unsigned int a = 0, b = 1;
+		if (trees[b].first < trees[a].first) std::swap(a, b);
+		for (unsigned int i = 2; i < trees.size(); i ++) {
+			if (trees[i].first < trees[a].first) b = a, a = i;
+			else if (trees[i].first < trees[b].first) b = i;
+		}
+		for (unsigned int k = 0; k < trees[b].second.size(); k ++) lengths[trees[b].second[k]] ++;
+		for (unsigned int k = 0; k < trees[a].second.size(); k ++) lengths[trees[a].second[k]] ++;
+		trees[a].first += trees[b].first;
+		trees[a].second.insert(trees[a].second.end(), trees[b].second.begin(), trees[b].second.end());
+		trees.erase(trees.begin() + b);
+	}
+}
+
+huffman_table::huffman_table(): contexts(false) {
+	char_counts none;
+	build(none, false);
+}
+
+void huffman_table::build(const char_counts &counts, bool use_contexts) {
+	contexts = use_contexts;
+	for (unsigned int c = 0; c < HUFFMAN_CONTEXTS; c ++) {
+		unsigned int from = use_contexts ? c : 0;
+		// every symbol gets a code, even if it is not in the corpus
+		std::vector <unsigned long long> weight(HUFFMAN_SYMBOLS);
+		for (unsigned int s = 0; s < HUFFMAN_SYMBOLS; s ++) weight[s] = counts.get(from, s) + 1;
+		// halves the weights until the longest code fits
+		while (true) {
+			code_lengths(weight, lengths[c]);
+			if (*std::max_element(lengths[c], lengths[c] + HUFFMAN_SYMBOLS) <= HUFFMAN_MAX_BITS) break;
+			for (unsigned int s = 0; s < HUFFMAN_SYMBOLS; s ++) weight[s] = weight[s] / 2 + 1;
+		}
+	}
+	_assign_codes();
+}
+
+// gives the codes of each length consecutive values, in symbol order
+void huffman_table::_assign_codes() {
+	for (unsigned int c = 0; c < HUFFMAN_CONTEXTS; c ++) {
+		memset(number[c], 0, sizeof(number[c]));
+		for (unsigned int s = 0; s < HUFFMAN_SYMBOLS; s ++) number[c][lengths[c][s]] ++;
+		number[c][0] = 0;
+
+		unsigned int code = 0, k = 0;
+		for (unsigned int len = 1; len <= HUFFMAN_MAX_BITS; len ++) {
+			code = (code + number[c][len - 1]) << 1;
+			first[c][len] = code;
+			for (unsigned int s = 0; s < HUFFMAN_SYMBOLS; s ++) {
+				if (lengths[c][s] != len) continue;
+				codes[c][s] = code ++;
+				sorted[c][k ++] = s;
+			}
+			code = first[c][len];
+		}
+	}
+}
+
+bool huffman_table::save(const std::string &path) const {
+	FILE* out = fopen(path.c_str(), "wb");
+	if (!out) return false;
+	unsigned char version[4] = {0, 0, 0, HUFFMAN_VERSION};
+	unsigned char flag = contexts;
+	bool ok = fwrite(HUFFMAN_MAGIC, 8, 1, out) == 1
+		&& fwrite(version, 4, 1, out) == 1
+		&& fwrite(&flag, 1, 1, out) == 1
+		&& fwrite(lengths, sizeof(lengths), 1, out) == 1;
+	return fclose(out) == 0 && ok;
+}
+
+bool huffman_table::load(const std::string &path) {
+	FILE* in = fopen(path.c_str(), "rb");
+	if (!in) return false;
+	char magic[8];
+	unsigned char version[4];
+	unsigned char flag;
+	unsigned char read_lengths[HUFFMAN_CONTEXTS][HUFFMAN_SYMBOLS];
+	bool ok = fread(magic, 8, 1, in) == 1 && memcmp(magic, HUFFMAN_MAGIC, 8) == 0
+		&& fread(version, 4, 1, in) == 1 && version[0] == 0 && version[1] == 0 && version[2] == 0 && version[3] == HUFFMAN_VERSION
+		&& fread(&flag, 1, 1, in) == 1 && flag <= 1
+		&& fread(read_lengths, sizeof(read_lengths), 1, in) == 1
+		&& fgetc(in) == EOF;
+	fclose(in);
+
+	// the lengths must make a complete prefix code: sum of 2^-length == 1
+	for (unsigned int c = 0; ok && c < HUFFMAN_CONTEXTS; c ++) {
+		unsigned long long kraft = 0;
+		for (unsigned int s = 0; ok && s < HUFFMAN_SYMBOLS; s ++) {
+			ok = read_lengths[c][s] >= 1 && read_lengths[c][s] <= HUFFMAN_MAX_BITS;
+			if (ok) kraft += 1ULL << (HUFFMAN_MAX_BITS - read_lengths[c][s]);
+		}
+		ok = ok && kraft == 1ULL << HUFFMAN_MAX_BITS;
+	}
+	if (!ok) return false;
+
+	contexts = flag;
+	memcpy(lengths, read_lengths, sizeof(lengths));
+	_assign_codes();
+	return true;
+}
+
+// FNV-1a over the code lengths
+unsigned long long huffman_table::checksum() const {
+	unsigned long long h = 14695981039346656037ULL;
+	h = (h ^ contexts) * 1099511628211ULL;
+	const unsigned char* bytes = &lengths[0][0];
+	for (unsigned int i = 0; i < sizeof(lengths); i ++) h = (h ^ bytes[i]) * 1099511628211ULL;
+	return h;
+}
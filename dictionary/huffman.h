@@ -0,0 +1,67 @@
+#ifndef __HUFFMAN__
+#define __HUFFMAN__
+
+#include <string>
+
+// canonical Huffman codes of the chars of the corpus. The symbols are the chars
+// with their normal codes (a = 1 .. z = 26, ' ' = 27, '.' = 28) and 0 for every
+// other char (an escape, followed by the char in 8 bits). There is a code for
+// each context: context 0 has no context, and context 1 + s follows a char of
+// symbol s (a word group starts after ' ')
+#define HUFFMAN_SYMBOLS 29
+#define HUFFMAN_CONTEXTS (1 + HUFFMAN_SYMBOLS)
+#define HUFFMAN_MAX_BITS 15
+
+// table file: the magic, the version, whether the contexts are used, then the
+// code length of every symbol in every context (one byte each)
+#define HUFFMAN_MAGIC "CHARHUFF"
+#define HUFFMAN_VERSION 1
+
+unsigned int huffman_symbol(char c);
+char huffman_char(unsigned int symbol);
+
+// the number of times each symbol follows each context in the corpus
+class char_counts {
+	private:
+		unsigned long long count[HUFFMAN_CONTEXTS][HUFFMAN_SYMBOLS];
+	public:
+		char_counts();
+		// counts the chars of a phrase of the corpus
+		void add(const std::string &phrase);
+		unsigned long long get(unsigned int context, unsigned int symbol) const { return count[context][symbol]; }
+};
+
+class huffman_table {
+	private:
+		bool contexts;
+		unsigned char lengths[HUFFMAN_CONTEXTS][HUFFMAN_SYMBOLS];
+		unsigned int codes[HUFFMAN_CONTEXTS][HUFFMAN_SYMBOLS];
+		// canonical decoding: the first code of each length, the number of codes
+		// of that length, and the symbols sorted by code
+		unsigned int first[HUFFMAN_CONTEXTS][HUFFMAN_MAX_BITS + 1];
+		unsigned int number[HUFFMAN_CONTEXTS][HUFFMAN_MAX_BITS + 1];
+		unsigned char sorted[HUFFMAN_CONTEXTS][HUFFMAN_SYMBOLS];
+		void _assign_codes();
+	public:
+		huffman_table();
+		// the codes for counts (every symbol gets a code, at most HUFFMAN_MAX_BITS
+		// long); without use_contexts, every context uses the code of context 0
+		void build(const char_counts &counts, bool use_contexts);
+		bool save(const std::string &path) const;
+		bool load(const std::string &path);
+		unsigned long long checksum() const;
+
+		// the context after a char (0 if the contexts are not used)
+		unsigned int context(char prev) const { return contexts ? 1 + huffman_symbol(prev) : 0; }
+		unsigned int length(unsigned int context, unsigned int symbol) const { return lengths[context][symbol]; }
+		unsigned int code(unsigned int context, unsigned int symbol) const { return codes[context][symbol]; }
+		// the symbol whose code in context is the len bits of code, or -1
+		int symbol(unsigned int context, unsigned int len, unsigned int code) const {
+			if (code < first[context][len] || code - first[context][len] >= number[context][len]) return -1;
+			unsigned int offset = 0;
+			for (unsigned int l = 1; l < len; l ++) offset += number[context][l];
+			return sorted[context][offset + code - first[context][len]];
+		}
+};
+
+#endif
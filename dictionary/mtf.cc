@@ -2,58 +2,123 @@
 #include <algorithm>
 #include <iostream>
 
+mtf::mtf(): numLive(0), longest(0) {}
+
 mtf::~mtf(){
-	std::vector< std::pair <std::string, CompressedWords*> >::iterator it;
-        for(it = dict.begin(); it != dict.end(); it++){
-                delete it->second;
+	std::vector <entry>::iterator it;
+        for(it = entries.begin(); it != entries.end(); it++){
+                if(it->live) delete it->cp;
         }
 
 }
 
 
-void mtf::insert(const std::string &word,CompressedWords * cp) {
-	std::vector< std::pair <std::string, CompressedWords*> >::iterator it;
-        for(it = dict.begin(); it != dict.end(); it++){
-                if(it->first == word && (cp == NULL || it->second->prevLetter == cp->prevLetter)) break;
-        }
+void mtf::add(unsigned long long time, long long delta) {
+	for(unsigned long long i = time + 1; i <= tree.size(); i += i & (~i + 1)) tree[i-1] += delta;
+}
+
+unsigned long long mtf::prefix(unsigned long long time) const {
+	unsigned long long sum = 0;
+	for(unsigned long long i = time + 1; i > 0; i -= i & (~i + 1)) sum += tree[i-1];
+	return sum;
+}
 
-	if (it != dict.end()) {
-		delete it->second;
-		dict.erase(it);
+unsigned long long mtf::select(unsigned long long k) const {
+	// descends the implicit tree, keeping the largest position with fewer than k before it
+	unsigned long long pos = 0;
+	unsigned long long step = 1;
+	while(step * 2 <= tree.size()) step *= 2;
+	for(; step > 0; step /= 2) {
+		if(pos + step <= tree.size() && tree[pos + step - 1] < k) {
+			pos += step;
+			k -= tree[pos - 1];
+		}
 	}
-	
-	// adds new entry at the start
-	std::pair<std::string, CompressedWords*> p;
-	p.first = word;
-	p.second = cp;
+	return pos;
+}
+
+void mtf::compact() {
+	std::vector <entry> old;
+	old.swap(entries);
+	entries.reserve(std::max(2 * numLive, (unsigned long long) 1024));
+	for(std::vector <entry>::iterator it = old.begin(); it != old.end(); it++) {
+		if(it->live) entries.push_back(*it);
+	}
+
+	// the timestamps keep their order, so the lists in where stay sorted
+	where.clear();
+	for(unsigned long long time = 0; time < entries.size(); time++) where[entries[time].word].push_back(time);
 
-	dict.insert(dict.begin(), p);
+	// builds the tree in O(n): each node passes its count to its parent
+	tree.assign(entries.capacity(), 0);
+	for(unsigned long long i = 1; i <= tree.size(); i++) {
+		if(i <= entries.size()) tree[i-1]++;
+		unsigned long long parent = i + (i & (~i + 1));
+		if(parent <= tree.size()) tree[parent-1] += tree[i-1];
+	}
 }
 
-unsigned long long mtf::index(const std::string &word) {
-        std::vector< std::pair <std::string, CompressedWords*> >::iterator it;
-	for(it = dict.begin(); it != dict.end(); it++){
-		if(it->first == word) break;
+void mtf::remove(unsigned long long time) {
+	entry &e = entries[time];
+	std::vector <unsigned long long> &times = where[e.word];
+	times.erase(std::find(times.begin(), times.end(), time));
+	if(times.empty()) where.erase(e.word);
+	delete e.cp;
+	e.cp = NULL;
+	e.word = std::string();
+	e.live = false;
+	add(time, -1);
+	numLive--;
+}
+
+void mtf::insert(const std::string &word,CompressedWords * cp) {
+	// removes the newest entry of word (with the same context as cp, if any)
+	std::unordered_map <std::string, std::vector <unsigned long long> >::iterator found = where.find(word);
+	if(found != where.end()) {
+		std::vector <unsigned long long> &times = found->second;
+		for(std::vector <unsigned long long>::reverse_iterator it = times.rbegin(); it != times.rend(); it++) {
+			if(cp == NULL || entries[*it].cp->prevLetter == cp->prevLetter) {
+				remove(*it);
+				break;
+			}
+		}
 	}
+	
+	// adds new entry at the start
+	if(entries.size() == tree.size()) compact();
+	entry e;
+	e.word = word;
+	e.cp = cp;
+	e.live = true;
+	where[word].push_back(entries.size());
+	longest = std::max(longest, (unsigned long long) word.size());
+	add(entries.size(), 1);
+	entries.push_back(e);
+	numLive++;
+}
 
-	if (it == dict.end()) return 0xffffffff;
-	return it - dict.begin();
+unsigned long long mtf::index(const std::string &word) {
+	if (word.size() > longest) return 0xffffffff;
+	std::unordered_map <std::string, std::vector <unsigned long long> >::iterator found = where.find(word);
+	if (found == where.end()) return 0xffffffff;
+	// the number of live entries newer than the newest entry of word
+	return numLive - prefix(found->second.back());
 }
 
 std::string mtf::word(const unsigned long long index) {
-	if (index < dict.size()) return dict[index].first;
+	if (index < numLive) return entries[select(numLive - index)].word;
 	return "OUT_OF_RANGE";
 }
 
 // returns the associated CompressedWord with word
 CompressedWords* mtf::findBest(const std::string &word, char lastLetter){
-	// searches for word
-        std::vector< std::pair <std::string, CompressedWords*> >::iterator it;
-        for(it = dict.begin(); it != dict.end(); it++){
-                if(it->first == word && it->second->prevLetter == lastLetter) break;
-        }
-
-        if (it == dict.end()) return NULL;
-        return it->second;
+	// searches for word, the newest entry first
+	std::unordered_map <std::string, std::vector <unsigned long long> >::iterator found = where.find(word);
+	if (found == where.end()) return NULL;
+	std::vector <unsigned long long> &times = found->second;
+	for(std::vector <unsigned long long>::reverse_iterator it = times.rbegin(); it != times.rend(); it++) {
+		if(entries[*it].cp->prevLetter == lastLetter) return entries[*it].cp;
+	}
+	return NULL;
 
 }
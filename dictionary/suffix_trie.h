@@ -4,6 +4,7 @@
 #include <string>
 #include <queue>
 #include <set>
+#include <vector>
 #include <iostream>
 
 struct word_counter {
@@ -13,6 +14,8 @@ struct word_counter {
 	bool operator < (const word_counter &other) const;
 };
 
+class flat_trie;
+
 struct trie_node {
 	unsigned long long count;
 	trie_node* child[27];
@@ -23,19 +26,39 @@ struct trie_node {
 class trie {
 	private:
 		trie_node* root;
+		unsigned long long nodes;
+		// a snapshot loaded by load(), answering all the searches
+		flat_trie* snapshot;
+		// fingerprint() of the trie as it is, if valid
+		unsigned long long fingerprint_value;
+		bool fingerprint_valid;
 		void _insert(trie_node* &current, std::string s);
-		std::set <word_counter> _match_words(std::string s, std::queue <unsigned int> dontcare, bool usedLast);
-		void _traverse(std::ostream & out, trie_node* &current);
-		void _load(std::istream & in, trie_node* &current);
 	public:
 		trie();
 		~trie();
 		void insert(const std::string &s);
 		bool approx_match(std::string s, const unsigned int max_mismatch);
 		long long get_rank(std::string s, std::queue <unsigned int> revealed, bool usedLast = false);
+		// get_rank of s for every queue in revealed, walking the trie once
+		std::vector <long long> get_ranks(std::string s, const std::vector <std::queue <unsigned int> > &revealed, bool usedLast = false);
 		std::string get_word(std::string s, const std::queue <unsigned int> revealed, unsigned long long rank, bool usedLast = false);
-		void traverse_trie();
-		void load();
+		// writes the trie as a snapshot file (see flat_trie.h)
+		bool save(const std::string &path) const;
+		// maps a snapshot file written by save() instead of building the trie
+		bool load(const std::string &path, bool verify = false);
+		// identifies the contents of the trie: the checksum of its snapshot,
+		// so a trie and the snapshot saved from it have the same fingerprint
+		unsigned long long fingerprint();
+
+		// node access for the searches in trie_search.h
+		typedef const trie_node* node_type;
+		node_type root_node() const { return root; }
+		unsigned long long node_count(node_type n) const { return n->count; }
+		node_type node_child(node_type n, unsigned int i) const { return n->child[i]; }
+
+		// number of nodes, and the bytes they take (without allocator overhead)
+		unsigned long long size() const;
+		unsigned long long memory_usage() const;
 };
 
 
@@ -1,4 +1,5 @@
 #include "suffix_trie.h"
+#include "flat_trie.h"
 
 #include <iostream>
 #include <queue>
@@ -17,5 +18,11 @@ int main() {
 	queue <unsigned int> q, p;
 	q.push(1);
 	cout << t.get_rank("the", q) << endl;
+
+	// the flat trie must give the same answers, whether copied or built by insert
+	flat_trie f(t), g;
+	g.insert("tbe");
+	g.insert("the");
+	cout << f.get_rank("the", q) << " " << g.get_rank("the", q) << " " << g.get_word("tbe", q, 0) << endl;
 	return 0;
 }
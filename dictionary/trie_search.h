@@ -0,0 +1,452 @@
+#ifndef __TRIE_SEARCH__
+#define __TRIE_SEARCH__
+
+#include "suffix_trie.h"
+
+#include <string>
+#include <queue>
+#include <stack>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+// The searches below are shared by every trie layout. A layout T provides
+//   T::node_type          a handle to a node (a 0 / NULL handle means "no node")
+//   t.root_node()         the handle of the root
+//   t.node_count(n)       the number of strings inserted through n
+//   t.node_child(n, i)    the child of n for char index i (26 is ' ')
+// Strings are stored reversed, so s is always the reversed word group.
+
+inline unsigned int char_index(char c) { return c == ' ' ? 26 : c - 'a'; }
+
+inline char index_char(unsigned int i) { return i == 26 ? ' ' : 'a' + i; }
+
+// returns all the words of length s.size() matching s, where the positions in
+// dontcare (counted on the unreversed word, after "x " if usedLast) may be any char
+template <class T>
+std::set <word_counter> trie_match_words(const T &t, const std::string &s, std::queue <unsigned int> dontcare, bool usedLast) {
+	typedef typename T::node_type node_type;
+	std::queue <std::pair <node_type, std::string> > q;
+	std::set <word_counter> matched_words;
+	q.push(std::make_pair(t.root_node(), ""));
+	std::stack <unsigned int> reverse_dontcare;
+
+	if(!usedLast) while (dontcare.size()) reverse_dontcare.push(s.size() - dontcare.front() - 1), dontcare.pop();
+	else while (dontcare.size()) reverse_dontcare.push(s.size() - dontcare.front() - 3), dontcare.pop();
+
+	while (!q.empty()) {
+		node_type current = q.front().first;
+		std::string word = q.front().second, next_word;
+		q.pop();
+		while (reverse_dontcare.size() && word.size() > reverse_dontcare.top()) reverse_dontcare.pop();
+		if (reverse_dontcare.size() && word.size() == reverse_dontcare.top()) {
+			for (int i = 0; i < 27; i ++) {
+				node_type next = t.node_child(current, i);
+				if (next) {
+					next_word = word + index_char(i);
+					if (next_word.size() == s.size())
+						matched_words.insert(word_counter(t.node_count(current), std::string(next_word.rbegin(), next_word.rend())));
+					else q.push(std::make_pair(next, next_word));
+				}
+			}
+		}
+		else {
+			node_type next = t.node_child(current, char_index(s[word.size()]));
+			if (next) {
+				next_word = word + s[word.size()];
+				if (next_word.size() == s.size())
+						matched_words.insert(word_counter(t.node_count(current), std::string(next_word.rbegin(), next_word.rend())));
+				else q.push(std::make_pair(next, next_word));
+			}
+		}
+	}
+	return matched_words;
+}
+
+// returns the position of s among the words matching it, or -1 if s is not in the trie
+template <class T>
+long long trie_rank(const T &t, std::string s, std::queue <unsigned int> dontcare, bool usedLast) {
+	s = std::string(s.rbegin(), s.rend());
+	std::set <word_counter> matched_words = trie_match_words(t, s, dontcare, usedLast);
+	long long rank = 0;
+	while (matched_words.size()) {
+		if (matched_words.begin()->word == std::string(s.rbegin(), s.rend())) return rank;
+		else rank ++, matched_words.erase(matched_words.begin());
+	}
+	return -1;
+}
+
+// marks the positions of the reversed word (of length n) that may be any char
+inline std::vector <bool> reverse_dontcare(unsigned int n, std::queue <unsigned int> dontcare, bool usedLast) {
+	std::vector <bool> wild(n, false);
+	unsigned int shift = usedLast ? 3 : 1;
+	while (dontcare.size()) {
+		if (dontcare.front() + shift <= n) wild[n - dontcare.front() - shift] = true;
+		dontcare.pop();
+	}
+	return wild;
+}
+
+// counts the matches of r (reversed, wildcards in wild) below current (at depth
+// depth, reached through path) that sort before r, whose parent count is target
+template <class T>
+void trie_count_before(const T &t, typename T::node_type current, unsigned int depth, const std::string &r,
+		const std::vector <bool> &wild, unsigned long long target, std::string &path, long long &rank) {
+	typedef typename T::node_type node_type;
+	unsigned long long count = t.node_count(current);
+	// counts only shrink going down, so nothing below can sort before r
+	if (count < target) return;
+
+	unsigned int n = r.size();
+	unsigned int from = wild[depth] ? 0 : char_index(r[depth]);
+	unsigned int to = wild[depth] ? 27 : from + 1;
+	for (unsigned int i = from; i < to; i ++) {
+		node_type next = t.node_child(current, i);
+		if (!next) continue;
+		path[depth] = index_char(i);
+		if (depth + 1 < n) {
+			trie_count_before(t, next, depth + 1, r, wild, target, path, rank);
+			continue;
+		}
+		// a match: its count is the count of current, ties are broken on the
+		// unreversed word, i.e. comparing from the end of the path
+		if (count > target) {
+			rank ++;
+			continue;
+		}
+		int d = n - 1;
+		while (d >= 0 && path[d] == r[d]) d --;
+		if (d >= 0 && path[d] < r[d]) rank ++;
+	}
+}
+
+// same as trie_rank, counting the matches that sort before s instead of
+// building the set of all the matches
+template <class T>
+long long trie_count_rank(const T &t, std::string s, std::queue <unsigned int> dontcare, bool usedLast) {
+	typedef typename T::node_type node_type;
+	unsigned int n = s.size();
+	if (!n) return -1;
+	std::string r(s.rbegin(), s.rend());
+
+	// the count of s is the count of the node before its last char
+	node_type current = t.root_node();
+	for (unsigned int d = 0; d < n; d ++) {
+		node_type next = t.node_child(current, char_index(r[d]));
+		if (!next) return -1;
+		if (d + 1 < n) current = next;
+	}
+	unsigned long long target = t.node_count(current);
+
+	std::vector <bool> wild = reverse_dontcare(n, dontcare, usedLast);
+	std::string path(n, ' ');
+	long long rank = 0;
+	trie_count_before(t, t.root_node(), 0, r, wild, target, path, rank);
+	return rank;
+}
+
+// trie_count_before for several sets of wildcards at once (wild[d][m] is set if
+// position d may be any char for set m): the trie is walked once, and a subtree
+// is only visited by the sets still matching it. active lists those sets, and
+// below depth d each call reuses the lists in scratch[d]
+template <class T>
+void trie_count_before_all(const T &t, typename T::node_type current, unsigned int depth, const std::string &r,
+		const std::vector <std::vector <bool> > &wild, unsigned long long target, std::string &path,
+		const std::vector <unsigned int> &active, std::vector <std::vector <unsigned int> > &scratch, std::vector <long long> &ranks) {
+	typedef typename T::node_type node_type;
+	unsigned long long count = t.node_count(current);
+	if (count < target) return;
+
+	// the sets with a wildcard here go down every child, the others only down r[depth]
+	std::vector <unsigned int> &any = scratch[depth];
+	any.clear();
+	for (unsigned int m = 0; m < active.size(); m ++)
+		if (wild[depth][active[m]]) any.push_back(active[m]);
+
+	unsigned int n = r.size();
+	unsigned int revealed = char_index(r[depth]);
+	for (unsigned int i = 0; i < 27; i ++) {
+		const std::vector <unsigned int> &sets = i == revealed ? active : any;
+		if (sets.empty()) continue;
+		node_type next = t.node_child(current, i);
+		if (!next) continue;
+		path[depth] = index_char(i);
+		if (depth + 1 < n) {
+			trie_count_before_all(t, next, depth + 1, r, wild, target, path, sets, scratch, ranks);
+			continue;
+		}
+		// a match, for all the sets reaching it: same order as trie_count_before
+		bool before = count > target;
+		if (!before) {
+			int d = n - 1;
+			while (d >= 0 && path[d] == r[d]) d --;
+			before = d >= 0 && path[d] < r[d];
+		}
+		if (before) for (unsigned int m = 0; m < sets.size(); m ++) ranks[sets[m]] ++;
+	}
+}
+
+// trie_count_rank of s for each queue of dontcare, in one walk of the trie;
+// all the ranks are -1 if s is not in the trie
+template <class T>
+std::vector <long long> trie_count_ranks(const T &t, std::string s, const std::vector <std::queue <unsigned int> > &dontcares, bool usedLast) {
+	typedef typename T::node_type node_type;
+	unsigned int n = s.size();
+	std::vector <long long> ranks(dontcares.size(), -1);
+	if (!n || dontcares.empty()) return ranks;
+	std::string r(s.rbegin(), s.rend());
+
+	node_type current = t.root_node();
+	for (unsigned int d = 0; d < n; d ++) {
+		node_type next = t.node_child(current, char_index(r[d]));
+		if (!next) return ranks;
+		if (d + 1 < n) current = next;
+	}
+	unsigned long long target = t.node_count(current);
+
+	std::vector <std::vector <bool> > wild(n, std::vector <bool> (dontcares.size()));
+	std::vector <unsigned int> active(dontcares.size());
+	for (unsigned int m = 0; m < dontcares.size(); m ++) {
+		std::vector <bool> w = reverse_dontcare(n, dontcares[m], usedLast);
+		for (unsigned int d = 0; d < n; d ++) wild[d][m] = w[d];
+		active[m] = m;
+		ranks[m] = 0;
+	}
+	std::vector <std::vector <unsigned int> > scratch(n);
+	std::string path(n, ' ');
+	trie_count_before_all(t, t.root_node(), 0, r, wild, target, path, active, scratch, ranks);
+	return ranks;
+}
+
+// returns the word at position rank among the words matching s
+template <class T>
+std::string trie_word(const T &t, std::string s, std::queue <unsigned int> dontcare, unsigned long long rank, bool usedLast) {
+	s = std::string(s.rbegin(), s.rend());
+	std::set <word_counter> matched_words = trie_match_words(t, s, dontcare, usedLast);
+
+	for (std::set <word_counter>::iterator i = matched_words.begin(); i != matched_words.end(); i ++, rank --) {
+		if (rank == 0) {
+			std::string currWord = i->word;
+			std::string res;
+			if(usedLast) res = currWord.substr(2);
+			else res = currWord;
+			return res;
+		}
+	}
+	return "NOT_FOUND";
+}
+
+// an entry of the best-first search of trie_select_word: a partial match, or
+// (match set) the parent of matches, all ranked by the count of the parent
+template <class N>
+struct select_entry {
+	unsigned long long count;
+	N node;
+	unsigned int depth;
+	int path;
+	bool match;
+	// the biggest count first; on equal counts, partial matches first
+	bool operator < (const select_entry &other) const {
+		if (count != other.count) return count < other.count;
+		return match && !other.match;
+	}
+};
+
+// the chars of the reversed word that may follow a node at depth depth
+inline unsigned int select_from(const std::string &r, const std::vector <bool> &wild, unsigned int depth) {
+	return wild[depth] ? 0 : char_index(r[depth]);
+}
+
+inline unsigned int select_to(const std::string &r, const std::vector <bool> &wild, unsigned int depth) {
+	return wild[depth] ? 27 : char_index(r[depth]) + 1;
+}
+
+// same as trie_word, without building the set of all the matches: the partial
+// matches are expanded biggest count first, so the matches come out in rank
+// order and the search stops as soon as the one at position rank is known
+template <class T>
+std::string trie_select_word(const T &t, std::string s, std::queue <unsigned int> dontcare, unsigned long long rank, bool usedLast) {
+	typedef typename T::node_type node_type;
+	unsigned int n = s.size();
+	if (!n) return "NOT_FOUND";
+	std::string r(s.rbegin(), s.rend());
+	std::vector <bool> wild = reverse_dontcare(n, dontcare, usedLast);
+
+	// chars of the partial matches: (index of the parent, char)
+	std::vector <std::pair <int, char> > paths;
+	std::priority_queue <select_entry <node_type> > frontier;
+	select_entry <node_type> start = {t.node_count(t.root_node()), t.root_node(), 0, -1, n == 1};
+	frontier.push(start);
+
+	while (!frontier.empty()) {
+		select_entry <node_type> current = frontier.top();
+		frontier.pop();
+		unsigned int from = select_from(r, wild, current.depth);
+		unsigned int to = select_to(r, wild, current.depth);
+
+		if (current.match) {
+			// no partial match with this count is left, so all the matches with this
+			// count are in the frontier: they take the next positions, by word
+			std::vector <select_entry <node_type> > tied(1, current);
+			while (!frontier.empty() && frontier.top().match && frontier.top().count == current.count) {
+				tied.push_back(frontier.top());
+				frontier.pop();
+			}
+			unsigned long long matches = 0;
+			for (unsigned int w = 0; w < tied.size(); w ++)
+				for (unsigned int i = from; i < to; i ++)
+					if (t.node_child(tied[w].node, i)) matches ++;
+			if (rank >= matches) {
+				rank -= matches;
+				continue;
+			}
+			std::vector <std::string> words;
+			for (unsigned int w = 0; w < tied.size(); w ++)
+				for (unsigned int i = from; i < to; i ++) {
+					if (!t.node_child(tied[w].node, i)) continue;
+					words.push_back(std::string(1, index_char(i)));
+					for (int p = tied[w].path; p >= 0; p = paths[p].first) words.back() += paths[p].second;
+				}
+			std::nth_element(words.begin(), words.begin() + rank, words.end());
+			if (usedLast) return words[rank].substr(2);
+			return words[rank];
+		}
+
+		for (unsigned int i = from; i < to; i ++) {
+			node_type next = t.node_child(current.node, i);
+			if (!next) continue;
+			paths.push_back(std::make_pair(current.path, index_char(i)));
+			select_entry <node_type> child = {t.node_count(next), next, current.depth + 1, (int) paths.size() - 1, false};
+			// follows the revealed chars down to the next wildcard (or the parent of
+			// the matches) right away: the deeper count still bounds the matches below
+			while (child.depth + 1 < n && !wild[child.depth]) {
+				next = t.node_child(child.node, char_index(r[child.depth]));
+				if (!next) break;
+				paths.push_back(std::make_pair(child.path, r[child.depth]));
+				child.node = next;
+				child.path = paths.size() - 1;
+				child.count = t.node_count(next);
+				child.depth ++;
+			}
+			if (child.depth + 1 < n) {
+				if (wild[child.depth]) frontier.push(child);
+				continue;
+			}
+			// the parent of matches: pushed as one entry if any match is below it
+			child.match = true;
+			for (unsigned int j = select_from(r, wild, child.depth); j < select_to(r, wild, child.depth); j ++)
+				if (t.node_child(child.node, j)) {
+					frontier.push(child);
+					break;
+				}
+		}
+	}
+	return "NOT_FOUND";
+}
+
+// a match of trie_collect_word: the count of its parent, the index of the
+// parent in the paths of the partial matches, and its last char
+struct collect_match {
+	unsigned long long count;
+	int path;
+	unsigned int last;
+	// the biggest count first
+	bool operator < (const collect_match &other) const { return count > other.count; }
+};
+
+// adds the matches of r (reversed, wildcards in wild) below current (at depth
+// depth, reached through path) to matches, and the partial matches to paths
+template <class T>
+void trie_collect_matches(const T &t, typename T::node_type current, unsigned int depth, int path, const std::string &r,
+		const std::vector <bool> &wild, std::vector <std::pair <int, char> > &paths, std::vector <collect_match> &matches) {
+	typedef typename T::node_type node_type;
+	unsigned int from = select_from(r, wild, depth);
+	unsigned int to = select_to(r, wild, depth);
+	if (depth + 1 == r.size()) {
+		collect_match match = {t.node_count(current), path, 0};
+		for (unsigned int i = from; i < to; i ++)
+			if (t.node_child(current, i)) {
+				match.last = i;
+				matches.push_back(match);
+			}
+		return;
+	}
+	for (unsigned int i = from; i < to; i ++) {
+		node_type next = t.node_child(current, i);
+		if (!next) continue;
+		paths.push_back(std::make_pair(path, index_char(i)));
+		trie_collect_matches(t, next, depth + 1, paths.size() - 1, r, wild, paths, matches);
+	}
+}
+
+// same as trie_word, with the matches kept as counts and indices instead of a
+// set of words: the count at position rank is selected, and only the words
+// with that count are built. trie_select_word is faster for the first ranks,
+// this one when the search has to visit most of the matches anyway
+template <class T>
+std::string trie_collect_word(const T &t, std::string s, std::queue <unsigned int> dontcare, unsigned long long rank, bool usedLast) {
+	unsigned int n = s.size();
+	if (!n) return "NOT_FOUND";
+	std::string r(s.rbegin(), s.rend());
+	std::vector <bool> wild = reverse_dontcare(n, dontcare, usedLast);
+
+	std::vector <std::pair <int, char> > paths;
+	std::vector <collect_match> matches;
+	trie_collect_matches(t, t.root_node(), 0, -1, r, wild, paths, matches);
+	if (rank >= matches.size()) return "NOT_FOUND";
+
+	// the matches with the count at position rank take the positions after the
+	// ones with bigger counts, by word
+	std::nth_element(matches.begin(), matches.begin() + rank, matches.end());
+	unsigned long long count = matches[rank].count;
+	std::vector <std::string> words;
+	for (unsigned int m = 0; m < matches.size(); m ++) {
+		if (matches[m].count > count) rank --;
+		if (matches[m].count != count) continue;
+		words.push_back(std::string(1, index_char(matches[m].last)));
+		for (int p = matches[m].path; p >= 0; p = paths[p].first) words.back() += paths[p].second;
+	}
+	std::nth_element(words.begin(), words.begin() + rank, words.end());
+	if (usedLast) return words[rank].substr(2);
+	return words[rank];
+}
+
+// the ranks below which trie_select_word stops early enough to beat trie_collect_word
+#define SELECT_MAX_RANK 2
+
+// returns the word at position rank among the words matching s, as trie_word
+template <class T>
+std::string trie_find_word(const T &t, std::string s, std::queue <unsigned int> dontcare, unsigned long long rank, bool usedLast) {
+	if (rank < SELECT_MAX_RANK) return trie_select_word(t, s, dontcare, rank, usedLast);
+	return trie_collect_word(t, s, dontcare, rank, usedLast);
+}
+
+// checks if s is in the trie with at most max_mismatch chars changed
+template <class T>
+bool trie_approx_match(const T &t, std::string s, const unsigned int max_mismatch) {
+	typedef typename T::node_type node_type;
+	s = std::string(s.rbegin(), s.rend());
+	std::queue <std::pair <node_type, std::pair <unsigned int, unsigned int> > > q;
+	q.push(std::make_pair(t.root_node(), std::make_pair(0, max_mismatch)));
+	while (!q.empty()) {
+		node_type current = q.front().first;
+		unsigned int next_char_idx = q.front().second.first;
+		unsigned int mismatch = q.front().second.second;
+		q.pop();
+		if (next_char_idx < s.size()) {
+			unsigned int idx = char_index(s[next_char_idx]);
+			if (t.node_child(current, idx))
+				q.push(std::make_pair(t.node_child(current, idx), std::make_pair(next_char_idx + 1, mismatch)));
+			if (mismatch) {
+				for (unsigned int i = 0; i < 27; i ++)
+					if (i != idx && t.node_child(current, i))
+						q.push(std::make_pair(t.node_child(current, i), std::make_pair(next_char_idx + 1, mismatch - 1)));
+			}
+		}
+		else if (t.node_count(current)) return true;
+	}
+	return false;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include "wordclass.h"
+#include "fields.h"
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <string>
+
+using namespace std;
+
+// rleEncode as it was, a bit at a time
+static BitWriter rleEncodeBits(BitReader & in){
+	BitWriter result;
+	result.writeBit(in.eof() || in.peek(1));
+	while(!in.eof()){
+		bool c = in.readBit();
+		unsigned long long count = 1;
+		while(!in.eof() && in.peek(1) == c){
+			in.readBit();
+			count++;
+		}
+		writeGamma(result, count, false);
+	}
+	return result;
+}
+
+// rleDecode as it was, filling 64 bits per write
+static BitWriter rleDecodeWrites(FieldReader & in){
+	bool first = in.flag(FIELD_RLE_FIRST);
+	BitWriter result;
+	while(in.flag(FIELD_RLE_MORE)){
+		unsigned long long total = in.number(FIELD_RLE_RUN);
+		while(total > 64){
+			result.write(first ? ~0ULL : 0, 64);
+			total -= 64;
+		}
+		result.write(first ? ~0ULL : 0, total);
+		first = !first;
+	}
+	return result;
+}
+
+// random bits, a 1 starting a run with probability 1 / gap and each run of 1s
+// ending with probability 1 / run
+static BitWriter randomBits(unsigned long long n, int gap, int run){
+	BitWriter bits;
+	bool one = false;
+	for(unsigned long long i = 0; i < n; i++){
+		one = one ? rand() % run != 0 : rand() % gap == 0;
+		bits.writeBit(one);
+	}
+	return bits;
+}
+
+// the bit vector of the case, commas and periods of text, as normalizeText
+// (normalize.h) finds it
+static BitWriter caseBits(const string & text){
+	BitWriter bits;
+	bool lastPeriod = true;
+	for(unsigned long long i = 0; i < text.length(); i++){
+		char c = text[i];
+		if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) lastPeriod = false;
+		if(c == ',') bits.write(2, 2);
+		else if(c >= 'A' && c <= 'Z') bits.writeBit(1);
+		else if(c == '.' && lastPeriod) bits.write(3, 2);
+		else {
+			if(c == '.') lastPeriod = true;
+			bits.writeBit(0);
+		}
+	}
+	return bits;
+}
+
+// the fastest of a few runs of encoding (or decoding) the bits, in milliseconds
+static void compare(const string & name, const BitWriter & bits, int repeats){
+	string packed = bits.bytes();
+	double encodeOld = 1e9, encodeNew = 1e9, decodeOld = 1e9, decodeNew = 1e9;
+	BitWriter coded, codedOld, decoded, decodedOld;
+	for(int r = 0; r < repeats; r++){
+		double t = omp_get_wtime();
+		BitReader in(packed, bits.size());
+		codedOld = rleEncodeBits(in);
+		double u = omp_get_wtime();
+		BitReader in2(packed, bits.size());
+		coded = rleEncode(in2);
+		double v = omp_get_wtime();
+		encodeOld = min(encodeOld, u - t);
+		encodeNew = min(encodeNew, v - u);
+	}
+
+	// the runs are read back as the gamma format holds them, at its end
+	const BitWriter & runs = coded;
+	string codedBytes = runs.bytes();
+	for(int r = 0; r < repeats; r++){
+		double t = omp_get_wtime();
+		BitReader in(codedBytes, runs.size());
+		GammaFieldReader fields(in, CharCodec(0, NULL));
+		decodedOld = rleDecodeWrites(fields);
+		double u = omp_get_wtime();
+		BitReader in2(codedBytes, runs.size());
+		GammaFieldReader fields2(in2, CharCodec(0, NULL));
+		decoded = rleDecode(fields2, ~0ULL);
+		double v = omp_get_wtime();
+		decodeOld = min(decodeOld, u - t);
+		decodeNew = min(decodeNew, v - u);
+	}
+
+	bool same = coded.text() == codedOld.text() && decoded.text() == bits.text() && decodedOld.text() == bits.text();
+	cout << name << ": " << bits.size() << " bits in " << coded.size() << ", " << (same ? "same" : "DIFFERENT")
+		<< "; encode " << 1000 * encodeOld << " -> " << 1000 * encodeNew << " ms, decode "
+		<< 1000 * decodeOld << " -> " << 1000 * decodeNew << " ms" << endl;
+}
+
+// compares rleEncode and rleDecode with the bit at a time versions they
+// replaced, on megabytes of random bits (sparse, as the case bits of a text
+// are, and dense) and on the case bits of each file
+//   bench_rle [megabytes] [file ...]
+int main(int argc, char ** argv){
+	unsigned long long megabytes = argc > 1 ? strtoull(argv[1], NULL, 10) : 4;
+	unsigned long long n = 8 * (megabytes << 20);
+	int repeats = 3;
+
+	srand(1);
+	compare("sparse", randomBits(n, 40, 2), repeats);
+	compare("runs", randomBits(n, 200, 100), repeats);
+	compare("dense", randomBits(n, 2, 2), repeats);
+	for(int i = 2; i < argc; i++){
+		ifstream in(argv[i]);
+		stringstream buffer;
+		buffer << in.rdbuf();
+		compare(argv[i], caseBits(buffer.str()), repeats);
+	}
+	return 0;
+}
@@ -0,0 +1,171 @@
+#include "bitstream.h"
+#include <cstring>
+
+using namespace std;
+
+BitWriter::BitWriter(): acc(0), used(0) {}
+
+void BitWriter::write(unsigned long long value, unsigned int n) {
+	if(n == 0) return;
+	if(n < 64) value &= (1ULL << n) - 1;
+
+	// room left in the accumulator
+	unsigned int room = 64 - used;
+	if(n < room) {
+		acc = (acc << n) | value;
+		used += n;
+		return;
+	}
+
+	// fills the accumulator with the first room bits of value, and keeps the rest
+	unsigned int rest = n - room;
+	unsigned long long word = (room == 64) ? 0 : acc << room;
+	full.push_back(word | (value >> rest));
+	acc = rest ? value & ((1ULL << rest) - 1) : 0;
+	used = rest;
+}
+
+void BitWriter::writeZeros(unsigned int n) {
+	while(n > 64) {
+		write(0, 64);
+		n -= 64;
+	}
+	write(0, n);
+}
+
+void BitWriter::writeRun(bool bit, unsigned long long n) {
+	unsigned long long fill = bit ? ~0ULL : 0;
+	// tops up the accumulator to a word, then adds the whole words at once
+	unsigned int head = 64 - used;
+	if(n < head) {
+		write(fill, n);
+		return;
+	}
+	write(fill, head);
+	n -= head;
+	full.insert(full.end(), n / 64, fill);
+	write(fill, n % 64);
+}
+
+void BitWriter::append(const BitWriter & other) {
+	for(vector<unsigned long long>::const_iterator it = other.full.begin(); it != other.full.end(); it++) write(*it, 64);
+	write(other.acc, other.used);
+}
+
+void BitWriter::clear() {
+	full.clear();
+	acc = 0;
+	used = 0;
+}
+
+string BitWriter::bytes() const {
+	string result;
+	result.reserve(8 * full.size() + 8);
+	for(vector<unsigned long long>::const_iterator it = full.begin(); it != full.end(); it++)
+		for(int shift = 56; shift >= 0; shift -= 8) result += (char) (*it >> shift);
+
+	// the last bits, left aligned
+	if(used) {
+		unsigned long long last = acc << (64 - used);
+		for(unsigned int i = 0; i < (used + 7) / 8; i++) result += (char) (last >> (56 - 8 * i));
+	}
+	return result;
+}
+
+string BitWriter::text() const {
+	string result;
+	result.reserve(size());
+	for(vector<unsigned long long>::const_iterator it = full.begin(); it != full.end(); it++)
+		for(int i = 63; i >= 0; i--) result += (*it >> i & 1) ? '1' : '0';
+	for(int i = used - 1; i >= 0; i--) result += (acc >> i & 1) ? '1' : '0';
+	return result;
+}
+
+
+BitReader::BitReader(const string & data, unsigned long long bits):
+	data((const unsigned char *) data.data()), bits(bits), pos(0), acc(0), avail(0) {}
+
+BitReader::BitReader(const unsigned char * data, unsigned long long bits):
+	data(data), bits(bits), pos(0), acc(0), avail(0) {}
+
+// loads whole bytes after the bits in acc, until at least 57 bits are there
+void BitReader::refill() {
+	unsigned long long numBytes = (bits + 7) / 8;
+	// the bits in acc end at a byte, so as many bytes as fit are loaded from
+	// one word when 8 are left
+	unsigned long long next = (pos + avail) / 8;
+	if(avail <= 56 && next + 8 <= numBytes) {
+		unsigned long long word;
+		memcpy(&word, data + next, 8);
+		word = __builtin_bswap64(word);
+		unsigned int take = 8 * ((64 - avail) / 8);
+		unsigned long long kept = (avail + take == 64) ? ~0ULL : ~(~0ULL >> (avail + take));
+		acc |= (word >> avail) & kept;
+		avail += take;
+		return;
+	}
+	while(avail <= 56) {
+		unsigned long long next = (pos + avail) / 8;
+		if(next >= numBytes) break;
+		acc |= (unsigned long long) data[next] << (56 - avail);
+		avail += 8;
+	}
+}
+
+unsigned long long BitReader::read(unsigned int n) {
+	if(n == 0) return 0;
+	if(n > 32) {
+		unsigned long long high = read(n - 32);
+		return (high << 32) | read(32);
+	}
+	if(avail < n) refill();
+	unsigned long long value = acc >> (64 - n);
+	acc <<= n;
+	avail = (avail > n) ? avail - n : 0;
+	pos += n;
+	return value;
+}
+
+unsigned long long BitReader::peek(unsigned int n) {
+	if(n == 0) return 0;
+	if(avail < n) refill();
+	return acc >> (64 - n);
+}
+
+unsigned long long BitReader::readRun() {
+	if(eof()) return 0;
+	if(avail == 0) refill();
+	bool bit = acc >> 63;
+	unsigned long long run = 0;
+	while(!eof()) {
+		if(avail < 57) refill();
+		// only the bits before the end count
+		unsigned int valid = (left() < avail) ? left() : avail;
+		unsigned long long word = bit ? ~acc : acc;
+		unsigned int z = word ? __builtin_clzll(word) : 64;
+		unsigned int skip = (z < valid) ? z : valid;
+		acc = (skip == 64) ? 0 : acc << skip;
+		avail -= skip;
+		pos += skip;
+		run += skip;
+		if(z < valid) break;
+	}
+	return run;
+}
+
+unsigned int BitReader::readZeros() {
+	unsigned int zeros = 0;
+	while(!eof()) {
+		if(avail < 57) refill();
+		// only the bits before the end count
+		unsigned int valid = (left() < avail) ? left() : avail;
+		unsigned int z = acc ? __builtin_clzll(acc) : 64;
+		unsigned int skip = (z < valid) ? z : valid;
+		acc = (skip == 64) ? 0 : acc << skip;
+		avail -= skip;
+		pos += skip;
+		zeros += skip;
+		if(z < valid) break;
+	}
+	return zeros;
+}
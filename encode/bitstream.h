@@ -0,0 +1,66 @@
+#ifndef __BITSTREAM_H__
+#define __BITSTREAM_H__
+#include <vector>
+#include <string>
+
+// writes bits most significant first into 64-bit words: a full accumulator is
+// stored as one word, so writing a code never allocates per bit
+class BitWriter {
+  private:
+	std::vector<unsigned long long> full;
+	// the bits not in full yet, in the low used bits of acc
+	unsigned long long acc;
+	unsigned int used;
+
+  public:
+	BitWriter();
+	// writes the n low bits of value (n <= 64), the highest first
+	void write(unsigned long long value, unsigned int n);
+	void writeBit(bool bit) { write(bit, 1); }
+	// writes n zeros
+	void writeZeros(unsigned int n);
+	// writes n copies of bit, a whole word at a time
+	void writeRun(bool bit, unsigned long long n);
+	// writes all the bits of other after the bits written so far
+	void append(const BitWriter & other);
+	void clear();
+	// the number of bits written
+	unsigned long long size() const { return 64ULL * full.size() + used; }
+	// the bits packed in bytes, the first bit in the highest bit of the first
+	// byte; the last byte is padded with zeros
+	std::string bytes() const;
+	// the bits as a string of '0' and '1', for debugging
+	std::string text() const;
+};
+
+// reads the bits of a buffer packed by BitWriter::bytes, 64 bits at a time
+class BitReader {
+  private:
+	const unsigned char * data;
+	unsigned long long bits;
+	unsigned long long pos;
+	// the bits after pos, left aligned: avail of them are valid
+	unsigned long long acc;
+	unsigned int avail;
+	void refill();
+
+  public:
+	// data holds bits bits, and must outlive the reader
+	BitReader(const std::string & data, unsigned long long bits);
+	BitReader(const unsigned char * data, unsigned long long bits);
+	// reads n bits (n <= 64) as a number, the first bit highest; reading past
+	// the end gives zeros
+	unsigned long long read(unsigned int n);
+	bool readBit() { return read(1); }
+	// the next n bits (n <= 57), without reading them
+	unsigned long long peek(unsigned int n);
+	// the number of zeros before the next 1 (or before the end), which are read
+	unsigned int readZeros();
+	// reads the run of bits equal to the next one (up to the end), counting them
+	// a word at a time; returns its length (0 at the end)
+	unsigned long long readRun();
+	unsigned long long left() const { return bits - pos; }
+	bool eof() const { return pos >= bits; }
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "chars.h"
+
+using namespace std;
+
+HuffmanChars::HuffmanChars(const huffman_table & codes): codes(codes), entries(HUFFMAN_CONTEXTS << HUFFMAN_TABLE_BITS) {
+	for(unsigned int context = 0; context < HUFFMAN_CONTEXTS; context++) {
+		for(unsigned int bits = 0; bits < (1u << HUFFMAN_TABLE_BITS); bits++) {
+			HuffmanEntry & e = entries[context << HUFFMAN_TABLE_BITS | bits];
+			e.count = 0;
+			unsigned int pos = 0;
+			unsigned int current = context;
+			while(e.count < HUFFMAN_TABLE_CODES) {
+				// the shortest code that starts at pos; an escape ends the entry
+				int symbol = -1;
+				unsigned int len = 1;
+				for(; symbol == -1 && pos + len <= HUFFMAN_TABLE_BITS; len++) {
+					unsigned int code = bits >> (HUFFMAN_TABLE_BITS - pos - len) & ((1u << len) - 1);
+					symbol = codes.symbol(current, len, code);
+				}
+				if(symbol <= 0) break;
+				pos += len - 1;
+				char c = huffman_char(symbol);
+				e.chars[e.count] = c;
+				e.bits[e.count++] = pos;
+				current = codes.context(c);
+			}
+		}
+	}
+}
+
+void HuffmanChars::write(BitWriter & out, char c, unsigned int context) const {
+	unsigned int symbol = huffman_symbol(c);
+	out.write(codes.code(context, symbol), codes.length(context, symbol));
+	// other chars follow the escape
+	if(symbol == 0) out.write((unsigned char) c, 8);
+}
+
+char HuffmanChars::read(BitReader & in, unsigned int context) const {
+	unsigned int code = 0;
+	for(unsigned int len = 1; len <= HUFFMAN_MAX_BITS; len++) {
+		code = code << 1 | in.readBit();
+		int symbol = codes.symbol(context, len, code);
+		if(symbol == 0) return in.read(8);
+		if(symbol > 0) return huffman_char(symbol);
+	}
+	return '\0';
+}
+
+
+CharCodec::CharCodec(int scheme, const HuffmanChars * huffman): table(&CHAR_TABLES[scheme == 1]), huffman(scheme == 2 ? huffman : NULL), encoding(scheme) {}
+
+void CharCodec::writeChars(BitWriter & out, const string & text) const {
+	if(gamma()) {
+		bool escaped = false;
+		for(unsigned int i = 0; i < text.length(); i++) {
+			writeGamma(out, code(text[i]), false);
+			escaped = escaped || code(text[i]) == CHAR_ESCAPE;
+		}
+		if(escaped)
+			for(unsigned int i = 0; i < text.length(); i++)
+				if(code(text[i]) == CHAR_ESCAPE) out.write((unsigned char) text[i], 8);
+		return;
+	}
+	const huffman_table & codes = huffman->table();
+	char prev = ' ';
+	for(unsigned int i = 0; i < text.length(); i++) {
+		huffman->write(out, text[i], codes.context(prev));
+		prev = text[i];
+	}
+}
+
+unsigned int CharCodec::charsLength(const char * text, unsigned int len) const {
+	unsigned int bits = 0;
+	if(gamma()) {
+		for(unsigned int i = 0; i < len; i++) bits += charLength(' ', text[i]);
+		return bits;
+	}
+	char prev = ' ';
+	for(unsigned int i = 0; i < len; i++) {
+		bits += charLength(prev, text[i]);
+		prev = text[i];
+	}
+	return bits;
+}
+
+unsigned int CharCodec::charLength(char prev, char c) const {
+	if(gamma()) return gammaLength(code(c), false) + (code(c) == CHAR_ESCAPE ? 8 : 0);
+	const huffman_table & codes = huffman->table();
+	unsigned int symbol = huffman_symbol(c);
+	return codes.length(codes.context(prev), symbol) + (symbol == 0 ? 8 : 0);
+}
+
+string CharCodec::readChars(BitReader & in, unsigned int len) const {
+	string result;
+	result.reserve(len);
+	if(gamma()) {
+		// reads the codes of all the chars, then decodes char-by-char
+		vector<unsigned long long> codes(len);
+		if(len > 0) readGammas(in, &codes[0], len, false);
+		for(unsigned int i = 0; i < len; i++) result += symbol(codes[i]);
+		for(unsigned int i = 0; i < len; i++)
+			if(codes[i] == CHAR_ESCAPE) result[i] = in.read(8);
+		return result;
+	}
+
+	const huffman_table & codes = huffman->table();
+	unsigned int context = codes.context(' ');
+	while(result.length() < len) {
+		// the table is only used away from the end, where the window is all real bits
+		if(in.left() >= HUFFMAN_TABLE_BITS) {
+			const HuffmanEntry & e = huffman->entry(context, in.peek(HUFFMAN_TABLE_BITS));
+			if(e.count) {
+				unsigned int n = e.count;
+				if(n > len - result.length()) n = len - result.length();
+				result.append(e.chars, n);
+				in.read(e.bits[n-1]);
+				context = codes.context(e.chars[n-1]);
+				continue;
+			}
+		}
+		char c = huffman->read(in, context);
+		result += c;
+		context = codes.context(c);
+	}
+	return result;
+}
+
+void CharCodec::writeChar(BitWriter & out, char c) const {
+	if(gamma()) {
+		writeGamma(out, code(c), false);
+		if(code(c) == CHAR_ESCAPE) out.write((unsigned char) c, 8);
+	} else huffman->write(out, c, 0);
+}
+
+char CharCodec::readChar(BitReader & in) const {
+	if(gamma()) {
+		unsigned long long n = readGamma(in, false);
+		return n == CHAR_ESCAPE ? in.read(8) : symbol(n);
+	}
+	return huffman->read(in, 0);
+}
@@ -0,0 +1,117 @@
+#ifndef __CHARS_H__
+#define __CHARS_H__
+#include <string>
+#include <vector>
+#include "gamma.h"
+#include "huffman.h"
+
+// the codes of the chars of the word groups, in the gamma schemes 0 and 1:
+//   0 (normal):    a = 1, b = 2, ... z = 26, ' ' = 27, '.' = 28
+//   1 (frequency): the chars by frequency, e = 1, t = 2, ... z = 27, '.' = 28
+// and CHAR_ESCAPE for any other char (a digit, '\n', ...), whose 8 bits follow
+// (see CharCodec::writeChars). Both tables are built at compile time; a
+// CharCodec picks one for a whole encode or decode, so a char costs one load.
+
+// the codes of the chars are 1 to NUM_CHAR_CODES - 1
+#define NUM_CHAR_CODES 29
+#define CHAR_ESCAPE NUM_CHAR_CODES
+
+// the chars of the frequency scheme, by code
+#define FREQUENCY_ORDER "\0etaoinshrdl cumwfgypbvkjxqz."
+
+struct CharTable {
+	// the code of each char, as an unsigned char
+	int code[256];
+	// the char of each code ('\0' for 0)
+	char symbol[NUM_CHAR_CODES];
+};
+
+constexpr CharTable makeCharTable(int scheme) {
+	CharTable table = {};
+	for(int i = 0; i < 256; i++) table.code[i] = CHAR_ESCAPE;
+	if(scheme == 1) {
+		for(int n = 1; n < NUM_CHAR_CODES; n++) {
+			table.code[(unsigned char) FREQUENCY_ORDER[n]] = n;
+			table.symbol[n] = FREQUENCY_ORDER[n];
+		}
+	} else {
+		table.code[(unsigned char) ' '] = 27;
+		table.code[(unsigned char) '.'] = 28;
+		for(int n = 1; n <= 26; n++) {
+			table.code['a' + n - 1] = n;
+			table.symbol[n] = 'a' + n - 1;
+		}
+		table.symbol[27] = ' ';
+		table.symbol[28] = '.';
+	}
+	return table;
+}
+
+constexpr CharTable CHAR_TABLES[2] = {makeCharTable(0), makeCharTable(1)};
+
+static_assert(CHAR_TABLES[0].code['z'] == 26 && CHAR_TABLES[0].symbol[27] == ' ', "normal char codes");
+static_assert(CHAR_TABLES[1].code['e'] == 1 && CHAR_TABLES[1].code[' '] == 12 && CHAR_TABLES[1].symbol[27] == 'z', "frequency char codes");
+static_assert(CHAR_TABLES[0].code['4'] == CHAR_ESCAPE && CHAR_TABLES[1].code['\n'] == CHAR_ESCAPE, "escaped chars");
+
+// the Huffman codes of scheme 2, trained on the corpus (see huffman.h), with a
+// table that decodes the chars of a word group several at a time: an entry
+// has the chars whose codes fit whole in the next HUFFMAN_TABLE_BITS bits,
+// each in the context of the char before it
+#define HUFFMAN_TABLE_BITS 10
+#define HUFFMAN_TABLE_CODES 4
+
+struct HuffmanEntry {
+	unsigned char count;
+	char chars[HUFFMAN_TABLE_CODES];
+	// the bits used by the first i + 1 chars
+	unsigned char bits[HUFFMAN_TABLE_CODES];
+};
+
+class HuffmanChars {
+  private:
+	huffman_table codes;
+	// [context << HUFFMAN_TABLE_BITS | the next bits]
+	std::vector<HuffmanEntry> entries;
+
+  public:
+	HuffmanChars(const huffman_table & codes);
+	const huffman_table & table() const { return codes; }
+	void write(BitWriter & out, char c, unsigned int context) const;
+	// one char, bit by bit
+	char read(BitReader & in, unsigned int context) const;
+	const HuffmanEntry & entry(unsigned int context, unsigned int bits) const { return entries[context << HUFFMAN_TABLE_BITS | bits]; }
+};
+
+// the char codes of one scheme (as EncodeOptions::encodingChars): codes written
+// in gamma for 0 and 1, or the Huffman codes of huffman for 2
+class CharCodec {
+  private:
+	const CharTable * table;
+	const HuffmanChars * huffman;
+	int encoding;
+
+  public:
+	explicit CharCodec(int scheme, const HuffmanChars * huffman = NULL);
+	int scheme() const { return encoding; }
+	bool gamma() const { return huffman == NULL; }
+	// the code of c and the char of code n, in the gamma schemes ('\0' if n is not a code)
+	int code(char c) const { return table->code[(unsigned char) c]; }
+	char symbol(unsigned long long n) const { return n < NUM_CHAR_CODES ? table->symbol[n] : '\0'; }
+	// identifies the codes, for caching what depends on them
+	unsigned long long fingerprint() const { return huffman ? huffman->table().checksum() : 0; }
+
+	// the chars of a word group, each in the context of the one before it; in the
+	// gamma schemes, the 8 bits of the escaped chars come after all the codes,
+	// so that readChars decodes the codes at once
+	void writeChars(BitWriter & out, const std::string & text) const;
+	// the number of bits writeChars writes for the len chars at text, and for the
+	// char c after the char prev (' ' for the first char of a word group)
+	unsigned int charsLength(const char * text, unsigned int len) const;
+	unsigned int charLength(char prev, char c) const;
+	std::string readChars(BitReader & in, unsigned int len) const;
+	// a char on its own (a revealed char), an escaped char right after its code
+	void writeChar(BitWriter & out, char c) const;
+	char readChar(BitReader & in) const;
+};
+
+#endif
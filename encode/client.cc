@@ -0,0 +1,57 @@
+#include "client.h"
+#include <cstring>
+#include <sys/un.h>
+
+using namespace std;
+
+CodecClient::CodecClient(const string & path): fd(-1) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(path.empty() || path.length() >= sizeof(address.sun_path)) return;
+	strcpy(address.sun_path, path.c_str());
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd >= 0 && connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+CodecClient::~CodecClient(){
+	if(fd >= 0) close(fd);
+}
+
+int CodecClient::request(char command, const string & data, unsigned int deadline, string & payload){
+	payload = "";
+	if(fd < 0) return SERVER_BROKEN;
+
+	string frame;
+	frame += command;
+	putNumber(frame, deadline, 4);
+	putNumber(frame, data.size(), 8);
+	frame += data;
+
+	string header;
+	if(sendAll(fd, frame) && receiveAll(fd, header, SERVER_REPLY_HEADER)) {
+		unsigned long long len = getNumber(header.data() + 1, 8);
+		if(receiveAll(fd, payload, len)) return (unsigned char) header[0];
+	}
+	// the frames are out of step: nothing more can be read from the connection
+	close(fd);
+	fd = -1;
+	payload = "";
+	return SERVER_BROKEN;
+}
+
+int CodecClient::compress(const string & text, string & data, unsigned int deadline){
+	return request(SERVER_COMPRESS, text, deadline, data);
+}
+
+int CodecClient::decompress(const string & data, string & text, unsigned int deadline){
+	return request(SERVER_DECOMPRESS, data, deadline, text);
+}
+
+int CodecClient::stats(string & text){
+	return request(SERVER_STATS, "", 0, text);
+}
@@ -0,0 +1,27 @@
+#ifndef __CLIENT_H__
+#define __CLIENT_H__
+#include <string>
+#include "protocol.h"
+
+// a connection to the codec daemon (see server.h). The requests return the
+// status of the reply (SERVER_OK, ...), or SERVER_BROKEN if the connection has
+// failed, after which the client has to be connected again. A client is used
+// by one thread at a time; threads each open their own.
+class CodecClient {
+  private:
+	int fd;
+	// sends a request and reads its reply into payload
+	int request(char command, const std::string & data, unsigned int deadline, std::string & payload);
+
+  public:
+	explicit CodecClient(const std::string & path);
+	~CodecClient();
+	bool connected() const { return fd >= 0; }
+	// deadline: the milliseconds the server has for the request (0: no limit)
+	int compress(const std::string & text, std::string & data, unsigned int deadline = 0);
+	int decompress(const std::string & data, std::string & text, unsigned int deadline = 0);
+	// the counters of the server, a "name value" line for each
+	int stats(std::string & text);
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "codec.h"
+#include "decode.h"
+#include "wordclass.h"
+#include "fields.h"
+
+using namespace std;
+
+// sets the comments of the decoder for the thread, as long as it is in scope
+class CommentScope {
+  private:
+	bool saved;
+
+  public:
+	CommentScope(bool comments): saved(COMMENT) { COMMENT = comments; }
+	~CommentScope() { COMMENT = saved; }
+};
+
+
+Compressor::Compressor(trie * GlobalSuffixTrie, const EncodeOptions & options, bool rangeCoded):
+	GlobalSuffixTrie(GlobalSuffixTrie), options(options), rangeCoded(rangeCoded),
+	broken(options.encodingChars == 2 && !options.huffman) {
+	// the fingerprint is found once, before the threads look it up
+	if(options.cache) GlobalSuffixTrie->fingerprint();
+}
+
+BitWriter Compressor::bits(const string & text) const {
+	if(broken) return BitWriter();
+	return bestCompression(text, GlobalSuffixTrie, options);
+}
+
+string Compressor::compress(const string & text) const {
+	if(broken) return "";
+	if(!rangeCoded) return packCompressed(bits(text), options.encodingChars);
+	RangeFieldWriter fields;
+	compressFields(text, GlobalSuffixTrie, options, fields);
+	return packRangeCoded(fields.finish(), options.encodingChars);
+}
+
+string Compressor::compress(const string & text, BitWriter & bits) const {
+	bits.clear();
+	if(broken) return "";
+	GammaFieldWriter gamma(bits, CharCodec(options.encodingChars, options.huffman));
+	if(!rangeCoded) {
+		compressFields(text, GlobalSuffixTrie, options, gamma);
+		return packCompressed(bits, options.encodingChars);
+	}
+	// both formats at once: the encoder runs once
+	RangeFieldWriter range;
+	FieldTee fields(gamma, range);
+	compressFields(text, GlobalSuffixTrie, options, fields);
+	return packRangeCoded(range.finish(), options.encodingChars);
+}
+
+unsigned long long Compressor::compress(istream & in, ostream & out, unsigned long long blockSize, unsigned long long blockPhrases,
+	int threads) const {
+	if(broken) return 0;
+	return encodeStream(in, out, GlobalSuffixTrie, blockSize, rangeCoded, threads, blockPhrases, options);
+}
+
+
+Decompressor::Decompressor(trie * GlobalSuffixTrie, const HuffmanChars * huffman, bool comments, unsigned long long maxChars):
+	GlobalSuffixTrie(GlobalSuffixTrie), huffman(huffman), comments(comments), maxChars(maxChars) {}
+
+bool Decompressor::decompress(const string & data, string & text) const {
+	int format, encodingChars;
+	unsigned long long size;
+	if(!unpackCompressed(data, format, encodingChars, size) || (encodingChars == 2 && !huffman)) return false;
+
+	CommentScope scope(comments);
+	const unsigned char * body = (const unsigned char *) data.data() + CODEC_HEADER_SIZE;
+	if(format == CODEC_RANGE) return decodeRangeCoded(body, size, GlobalSuffixTrie, maxChars, text);
+	BitReader in(body, size);
+	return decodeText(in, GlobalSuffixTrie, CharCodec(encodingChars, huffman), maxChars, text);
+}
+
+bool Decompressor::decodeBits(BitReader & in, int encodingChars, string & text) const {
+	CommentScope scope(comments);
+	return decodeText(in, GlobalSuffixTrie, CharCodec(encodingChars, huffman), maxChars, text);
+}
+
+bool Decompressor::decompress(int in, int out, unsigned long long * chars, int threads) const {
+	CommentScope scope(comments);
+	return decodeStream(in, out, GlobalSuffixTrie, huffman, chars, threads);
+}
+
+bool Decompressor::decompressRange(int fd, unsigned long long phraseBegin, unsigned long long phraseEnd, string & text) const {
+	CommentScope scope(comments);
+	StreamIndex index(fd, GlobalSuffixTrie, huffman);
+	return !index.failed() && index.decodeRange(phraseBegin, phraseEnd, text);
+}
@@ -0,0 +1,72 @@
+#ifndef __CODEC_H__
+#define __CODEC_H__
+#include <string>
+#include <iostream>
+#include "suffix_trie.h"
+#include "bitstream.h"
+#include "encode.h"
+#include "decode.h"
+#include "chars.h"
+#include "stream.h"
+
+// The codec as a library. A Compressor (or Decompressor) holds the options of
+// its compressions, and the trie and the Huffman codes, which it only reads: its
+// methods are const and keep what they work on to the call, so threads can share
+// one, and compressors with other options can work at once. A program builds the
+// trie (or maps its snapshot) once, then makes the contexts it needs.
+class Compressor {
+  private:
+	trie * GlobalSuffixTrie;
+	const EncodeOptions options;
+	bool rangeCoded;
+	bool broken;
+
+  public:
+	// rangeCoded: the files are in the range format, not the gamma one
+	Compressor(trie * GlobalSuffixTrie, const EncodeOptions & options = EncodeOptions(), bool rangeCoded = false);
+	const EncodeOptions & settings() const { return options; }
+	// whether the options cannot be written: chars scheme 2 without the Huffman
+	// codes. Such a compressor compresses nothing (its files are empty, and its
+	// streams are not written)
+	bool failed() const { return broken; }
+	// the bits of the gamma format of text
+	BitWriter bits(const std::string & text) const;
+	// text as a compressed file (see packCompressed), in the format of the
+	// compressor
+	std::string compress(const std::string & text) const;
+	// the same, with the bits of its gamma format in bits (as bits() has them)
+	std::string compress(const std::string & text, BitWriter & bits) const;
+	// all the text of in to out as a stream of blocks (see StreamEncoder); returns
+	// the bytes written
+	unsigned long long compress(std::istream & in, std::ostream & out, unsigned long long blockSize = STREAM_BLOCK_SIZE,
+		unsigned long long blockPhrases = 0, int threads = 0) const;
+};
+
+class Decompressor {
+  private:
+	trie * GlobalSuffixTrie;
+	const HuffmanChars * huffman;
+	// whether the fields are printed as they are decoded (see COMMENT)
+	bool comments;
+	// the most chars a compressed file (not a stream) decodes to
+	unsigned long long maxChars;
+
+  public:
+	// huffman: the codes of chars scheme 2 (NULL: none, and such files are refused);
+	// a file that would decode to more than maxChars chars is refused as broken
+	Decompressor(trie * GlobalSuffixTrie, const HuffmanChars * huffman, bool comments = false,
+		unsigned long long maxChars = DECODE_MAX_CHARS);
+	// the text of a compressed file in the gamma or range format; false if data
+	// is not one, is broken, or is in chars scheme 2 without the Huffman codes
+	bool decompress(const std::string & data, std::string & text) const;
+	// the text of the bits of the gamma format, in the chars scheme encodingChars;
+	// false if they are broken
+	bool decodeBits(BitReader & in, int encodingChars, std::string & text) const;
+	// the stream of blocks from the file descriptor in to out (see decodeStream)
+	bool decompress(int in, int out, unsigned long long * chars = NULL, int threads = 0) const;
+	// the phrases phraseBegin to phraseEnd - 1 of the stream of blocks in the
+	// file fd (see StreamIndex); false if it has no index, or a block is broken
+	bool decompressRange(int fd, unsigned long long phraseBegin, unsigned long long phraseEnd, std::string & text) const;
+};
+
+#endif
@@ -0,0 +1,320 @@
+#include "codec.h"
+#include "chars.h"
+#include "huffman.h"
+#include "fields.h"
+#include "server.h"
+#include "client.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <csignal>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(const string & name, bool ok){
+	cout << name << ": " << (ok ? "ok" : "FAILED") << endl;
+	if(!ok) failures++;
+}
+
+// compresses and decompresses text in every chars scheme, with a small trie;
+// returns the size of the compressed file of scheme 0
+static unsigned long long roundTrip(const string & name, const string & text, trie * t, const HuffmanChars * huffman){
+	unsigned long long size = 0;
+	for(int scheme = 0; scheme <= 2; scheme++){
+		EncodeOptions options;
+		options.encodingChars = scheme;
+		options.huffman = huffman;
+		for(int range = 0; range <= 1; range++){
+			string data = Compressor(t, options, range).compress(text);
+			string back;
+			bool ok = Decompressor(t, huffman).decompress(data, back) && back == text;
+			check(name + ", scheme " + char('0' + scheme) + (range ? ", range" : ""), ok);
+			if(scheme == 0 && !range) size = data.size();
+		}
+	}
+	return size;
+}
+
+// the text of a stream of blocks, decoded from a file to another
+static bool readStream(const string & stream, trie * t, const HuffmanChars * huffman, string & text){
+	FILE * in = tmpfile();
+	FILE * out = tmpfile();
+	bool ok = in && out && fwrite(stream.data(), 1, stream.size(), in) == stream.size() && fflush(in) == 0
+		&& fseek(in, 0, SEEK_SET) == 0 && Decompressor(t, huffman).decompress(fileno(in), fileno(out));
+	text = "";
+	char buffer[4096];
+	unsigned long long n;
+	if(ok && fseek(out, 0, SEEK_SET) == 0)
+		while((n = fread(buffer, 1, sizeof(buffer), out)) > 0) text.append(buffer, n);
+	if(in) fclose(in);
+	if(out) fclose(out);
+	return ok;
+}
+
+// a block without a period is one phrase, segmented in parts of PHRASE_MAX_WORDS
+// words: its time grows with its words, not with their cube, and so does its
+// memory, not with their square
+static void noPeriods(trie * t, const HuffmanChars * huffman){
+	string text = "";
+	for(int i = 0; i < 10000; i++) text += (i % 3) ? "we paid for it " : "then we paid ";
+	clock_t start = clock();
+	istringstream in(text);
+	ostringstream out;
+	Compressor(t).compress(in, out, STREAM_BLOCK_SIZE, 0, 1);
+	double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	cout << text.length() << " chars without a period in " << out.str().size() << " bytes, " << seconds << " s, "
+		<< usage.ru_maxrss / 1024 << " MB" << endl;
+	check("no periods, time", seconds < 10);
+	check("no periods, memory", usage.ru_maxrss < 256 * 1024);
+
+	string back;
+	check("no periods, round trip", readStream(out.str(), t, huffman, back) && back == text);
+}
+
+// streams whose header claims blocks (or a block) larger than the decoder takes:
+// it refuses them before it holds more than the bytes that are there
+static void brokenStreams(trie * t, const HuffmanChars * huffman){
+	string streams[3] = {
+		codecHeader(CODEC_BLOCKS, 0, 1ULL << 40) + codecHeader(CODEC_RANGE, 0, 1ULL << 41) + "1234",
+		codecHeader(CODEC_BLOCKS, 0, 100) + codecHeader(CODEC_RANGE, 0, ~0ULL) + "1234",
+		// (as bits, the length of its bytes must not wrap around)
+		codecHeader(CODEC_BLOCKS, 0, 100) + codecHeader(CODEC_GAMMA, 0, ~0ULL) + "1234"
+	};
+	for(int i = 0; i < 3; i++){
+		string back;
+		check(string("broken stream ") + char('0' + i), !readStream(streams[i], t, huffman, back));
+
+		FILE * file = tmpfile();
+		bool ok = file && fwrite(streams[i].data(), 1, streams[i].size(), file) == streams[i].size() && fflush(file) == 0;
+		check(string("broken stream ") + char('0' + i) + ", range", ok && !Decompressor(t, huffman).decompressRange(fileno(file), 0, 1, back));
+		if(file) fclose(file);
+	}
+}
+
+// the fields of a file whose numbers claim more than its bits hold: a normal
+// group of almost 2^32 chars, as many revealed chars or word groups, 2^50
+// spaces, or a run of 2^50 case bits
+#define BROKEN_FILES 5
+static void brokenFields(FieldWriter & out, int kind){
+	out.flag(FIELD_DOT, false);
+	if(kind <= 2) {
+		out.flag(FIELD_PHRASE, true);
+		out.number(FIELD_GROUPS, kind == 2 ? 0xFFFFFFF0ULL : 1);
+		out.scheme(kind == 1 ? SCHEME_GLOBAL : SCHEME_NORMAL);
+		if(kind == 1) out.number(FIELD_REVEALS, 0xFFFFFFF0ULL);
+		else out.number(FIELD_LENGTH, 0xFFFFFFF0ULL);
+		out.literals("we");
+	}
+	out.flag(FIELD_PHRASE, false);
+	out.number(FIELD_SPACES, kind == 3 ? 1ULL << 50 : 1);
+	out.number(FIELD_SPACES, 1);
+	out.flag(FIELD_RLE_FIRST, true);
+	out.flag(FIELD_RLE_MORE, true);
+	out.number(FIELD_RLE_RUN, kind == 4 ? 1ULL << 50 : 1);
+	out.flag(FIELD_RLE_MORE, false);
+}
+
+// the file of brokenFields, in either format
+static string brokenFile(int kind, bool range){
+	if(range) {
+		RangeFieldWriter fields;
+		brokenFields(fields, kind);
+		return packRangeCoded(fields.finish(), 0);
+	}
+	BitWriter bits;
+	GammaFieldWriter fields(bits, CharCodec(0));
+	brokenFields(fields, kind);
+	return packCompressed(bits, 0);
+}
+
+// the decoder refuses the files whose lengths their bits cannot back, without
+// trying to hold what they claim
+static void brokenFiles(trie * t, const HuffmanChars * huffman){
+	for(int kind = 0; kind < BROKEN_FILES; kind++)
+		for(int range = 0; range <= 1; range++){
+			string back;
+			check(string("broken file ") + char('0' + kind) + (range ? ", range" : ""),
+				!Decompressor(t, huffman).decompress(brokenFile(kind, range), back));
+		}
+}
+
+// a server (in a process of its own) fails a request with a broken payload,
+// and keeps serving the next ones
+static void serverKeepsServing(trie * t, const HuffmanChars * huffman){
+	string path = "/tmp/codec_test_" + to_string(getpid()) + ".sock";
+	pid_t child = fork();
+	if(child == 0) {
+		const Compressor compressor(t);
+		const Decompressor decompressor(t, huffman, false, SERVER_MAX_PAYLOAD);
+		CodecServer server(path, compressor, decompressor, 2);
+		server.run();
+		_exit(server.listening() ? 0 : 1);
+	}
+
+	CodecClient * client = NULL;
+	for(int tries = 0; tries < 500 && (!client || !client->connected()); tries++){
+		delete client;
+		usleep(10000);
+		client = new CodecClient(path);
+	}
+	string text = "We paid for it. Then, we left.";
+	string data, back;
+	bool failed = true, served = true;
+	for(int kind = 0; kind < BROKEN_FILES; kind++)
+		for(int range = 0; range <= 1; range++)
+			failed = failed && client->decompress(brokenFile(kind, range), back) == SERVER_FAILED;
+	served = client->compress(text, data) == SERVER_OK && client->decompress(data, back) == SERVER_OK && back == text;
+	delete client;
+
+	kill(child, SIGTERM);
+	int status;
+	check("server, broken payloads", failed);
+	check("server, serving after them", served && waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+// every phrase of a stream, decoded from the index with the blocks it is in:
+// with every block size, some phrases start right at a block boundary, and some
+// hold spaces, digits or periods at the end of the block before
+static void phraseRanges(trie * t, const HuffmanChars * huffman){
+	string text = "We paid. 42.  Then we paid for it.  1 2 3 for it. Then. 7";
+	// the phrases, as StreamBlock counts them
+	vector<string> phrases(1, "");
+	bool inside = false;
+	for(unsigned int i = 0; i < text.length(); i++){
+		phrases.back() += text[i];
+		if(isalpha(text[i])) inside = true;
+		else if(text[i] == '.' && inside){
+			inside = false;
+			phrases.push_back("");
+		}
+	}
+
+	string wrong = "";
+	for(unsigned int blockSize = 4; blockSize <= text.length(); blockSize++){
+		istringstream in(text);
+		ostringstream out;
+		Compressor(t).compress(in, out, blockSize, 0, 1);
+		FILE * file = tmpfile();
+		bool ok = file && fwrite(out.str().data(), 1, out.str().size(), file) == out.str().size() && fflush(file) == 0;
+		string all = "";
+		for(unsigned int p = 0; ok && p < phrases.size(); p++){
+			string phrase;
+			ok = Decompressor(t, huffman).decompressRange(fileno(file), p, p + 1, phrase) && phrase == phrases[p];
+			all += phrase;
+		}
+		string rest;
+		ok = ok && all == text && Decompressor(t, huffman).decompressRange(fileno(file), 2, phrases.size(), rest)
+			&& rest == text.substr(phrases[0].length() + phrases[1].length());
+		if(file) fclose(file);
+		if(!ok) wrong += " " + to_string(blockSize);
+	}
+	if(!wrong.empty()) cout << "wrong phrases in blocks of" << wrong << " chars" << endl;
+	check("phrases at block boundaries", wrong.empty());
+}
+
+// the chars that take the most bits: escaped, in groups of one char, between
+// periods and commas, and any byte (but '\n', as the first newline of a series
+// is dropped). Their blocks are within STREAM_MAX_BLOCK in every scheme, so the
+// decoder takes them
+static void blockBound(trie * t, const HuffmanChars * huffman){
+	string texts[3] = {"", "", ""};
+	unsigned int random = 1;
+	for(int i = 0; i < 500; i++){
+		texts[0] += char('0' + i % 10);
+		texts[0] += ' ';
+		texts[1] += (i % 2) ? "7. " : "Q, 8,";
+		random = random * 1103515245 + 12345;
+		char c = random >> 16;
+		texts[2] += (c == '\n') ? ' ' : c;
+	}
+
+	unsigned long long worst = 0;
+	for(int i = 0; i < 3; i++){
+		const string & text = texts[i];
+		for(int scheme = 0; scheme <= 2; scheme++){
+			EncodeOptions options;
+			options.encodingChars = scheme;
+			options.huffman = huffman;
+			unsigned long long bits = Compressor(t, options).bits(text).size();
+			if(bits * 1000 / text.length() > worst) worst = bits * 1000 / text.length();
+			check(string("bound ") + char('0' + i) + ", scheme " + char('0' + scheme), bits <= STREAM_MAX_CHAR_BITS * text.length());
+
+			for(int range = 0; range <= 1; range++){
+				istringstream in(text);
+				ostringstream out;
+				Compressor(t, options, range).compress(in, out, text.length(), 0, 1);
+				string back;
+				check(string("bound ") + char('0' + i) + ", scheme " + char('0' + scheme) + (range ? ", range" : "") + ", stream",
+					readStream(out.str(), t, huffman, back) && back == text);
+			}
+		}
+	}
+	cout << "at most " << worst / 1000.0 << " bits a char, of " << STREAM_MAX_CHAR_BITS << endl;
+}
+
+// round trips of the codec on texts with chars outside its alphabet, and their
+// sizes, and on blocks without a period or of the longest chars, and of
+// the phrases of a stream, and on broken streams and files, also sent to a
+// server
+int main() {
+	trie t;
+	t.insert("we paid");
+	t.insert("for it");
+	t.insert("then");
+	char_counts counts;
+	counts.add("we paid for it then");
+	huffman_table codes;
+	codes.build(counts, true);
+	HuffmanChars huffman(codes);
+
+	// first, as the server runs in a child process, which has to be forked
+	// before OpenMP starts its threads
+	serverKeepsServing(&t, &huffman);
+
+	// the chars without a code of their own take their escape and 8 bits
+	CharCodec normal(0), frequency(1);
+	check("digit bits", normal.charsLength("2024", 4) == 4 * (gammaLength(CHAR_ESCAPE, false) + 8)
+		&& frequency.charsLength("2024", 4) == normal.charsLength("2024", 4));
+
+	roundTrip("letters", "We paid for it. Then, we left.", &t, &huffman);
+	roundTrip("digits", "We paid 42 dollars for it. Then, 1999 came.", &t, &huffman);
+	// scheme 2 needs the codes: without them, nothing is written in a scheme the
+	// decoders would refuse
+	EncodeOptions noCodes;
+	noCodes.encodingChars = 2;
+	Compressor noHuffman(&t, noCodes);
+	ostringstream noStream;
+	istringstream noText("We paid.");
+	check("scheme 2 without codes", noHuffman.failed() && noHuffman.compress("We paid.") == ""
+		&& noHuffman.compress(noText, noStream) == 0 && noStream.str() == "");
+
+	roundTrip("symbols", "It cost $42 (or 40%)! Then: we paid for it?", &t, &huffman);
+
+	// a digit takes 17 bits (a 127 bit code when its code was negative), so 10
+	// digits in every 16 chars fit in 2 bytes a char
+	string digits = "";
+	for(int i = 0; i < 200; i++) digits += "room 1234567890 ";
+	unsigned long long size = roundTrip("many digits", digits, &t, &huffman);
+	cout << digits.length() << " chars in " << size << " bytes" << endl;
+	check("digit size", size < 2 * digits.length());
+
+	noPeriods(&t, &huffman);
+	brokenFiles(&t, &huffman);
+	brokenStreams(&t, &huffman);
+	phraseRanges(&t, &huffman);
+	blockBound(&t, &huffman);
+
+	return failures != 0;
+}
@@ -1,9 +1,11 @@
 #include "decode.h"
 #include "wordclass.h"
 #include "mtf.h"
+#include "fields.h"
 #include <vector>
 #include <queue>
 #include <sstream>
+#include <algorithm>
 
 using namespace std;
 
@@ -11,80 +13,9 @@ using namespace std;
 bool COMMENT = true;
 
 
-// converts first number from in to an int
-int convertToInt(istringstream & in, bool addOne = true){
-	// length of number in binary, obtained by reading all 0s at the start
-	int i = 1;
-	char c;
-	while(in >> c && c == '0') i++;
-	// the number in binary
-
-	if(!addOne) in.putback(c);
-	stringstream num;
-	while(i > 0){
-		in >> c;
-		num << c;
-		i--;
-	}
-
-	// the desired number in binary
-	int binary;
-	num >> binary;
-	// converts binary to int
-
-	int factor = 1;
-	// the result
-	int total = 0;
-
-        while (binary != 0) {
-        	total += (binary % 10) * factor;
-        	binary /= 10;
-        	factor *= 2;
-        }
-
-        return total;
-}
-
-
-// same as above, for long long
-// converts first number from in to an int
-unsigned long long convertToIntLong(istringstream & in, bool addOne = true){
-        // length of number in binary, obtained by reading all 0s at the start
-        int i = 1;
-        char c;
-        while(in >> c && c == '0') i++;
- 
-        if(!addOne) in.putback(c);
-        // the number in binary
-        stringstream num;
-        while(i > 0){
-                in >> c;
-                num << c;
-                i--;
-        }
-
-        // the desired number in binary
-        unsigned long long binary;
-        num >> binary;
-        // converts binary to int
-
-        unsigned long long factor = 1;
-        // the result
-        unsigned long long total = 0;
-
-        while (binary != 0) {
-                total += (binary % 10) * factor;
-                binary /= 10;
-                factor *= 2;
-        }
-
-        return total;
-}
-
-
 // decodes the first word from in, given that it
-// was encoded using the global dictionary
-string decodeGlobal (istringstream & in, trie * GlobalSuffixTrie, char lastLetter) {
+// was encoded using the global dictionary, of at most maxChars chars
+string decodeGlobal (FieldReader & in, trie * GlobalSuffixTrie, char lastLetter, unsigned long long maxChars) {
 	// encoding to be added before guesses, i.e. lastLetter + " "
         string start = "";
 	if(lastLetter != '!'){
@@ -94,7 +25,11 @@ string decodeGlobal (istringstream & in, trie * GlobalSuffixTrie, char lastLette
 	}
 
 	// the number of revealed chars
-	int numReveals = convertToInt(in);
+	unsigned long long numReveals = in.number(FIELD_REVEALS);
+	if(numReveals > in.left() || numReveals > maxChars) {
+		in.fail();
+		return "";
+	}
 
 	if(COMMENT) cout << "NUM REVEALS : " << numReveals << endl;
 
@@ -105,41 +40,41 @@ string decodeGlobal (istringstream & in, trie * GlobalSuffixTrie, char lastLette
 	ostringstream guessed;
 
 	// current index in the word
-	int index = -1;
+	long long index = -1;
 
 	// decodes all revealed chars and determines their indices
-	while(numReveals > 0) {
-
-		// position difference from current value of index
-		int t1 = convertToInt(in, false);
-		// the revealed char, as an int
-		int t2 = convertToInt(in,false);
+	for(unsigned long long i = 0; i < numReveals; i++) {
+
+		// position difference from current value of index (the word holds at
+		// most maxChars positions)
+		unsigned long long t1 = in.number(FIELD_POSITION);
+		if(t1 > maxChars - (index + 1)) {
+			in.fail();
+			return "";
+		}
 
-		for(int j = index + 1; j < index + t1; j++){
+		for(long long j = index + 1; j < index + (long long) t1; j++){
 			revealedQueue.push(j);
 			guessed << '_';
 		}
 
 		index += t1;
 
-		// determines the revealed char
-		char c;
-		if(ENCODINGCHARS == 1) c = intToChar(t2);
-		else {
-			if(t2 == 27) c = ' '; 
-			else c = t2 + 'a' - 1;
-		}
+		// the revealed char
+		char c = in.revealed();
 		guessed << c;
 
 		if(COMMENT) cout << "char : " << c << ", pos diff : " << t1 << " , current index : " << index << endl;
-
-		numReveals--;
 	} 
 
 	// position difference to the end of the word
-	int t1 = convertToInt(in,false);
+	unsigned long long t1 = in.number(FIELD_END);
+	if(t1 > maxChars - index) {
+		in.fail();
+		return "";
+	}
 
-        for(int j = index + 1; j < index + t1; j++){
+        for(long long j = index + 1; j < index + (long long) t1; j++){
                 revealedQueue.push(j);
         	guessed << '_';
        	}
@@ -147,7 +82,7 @@ string decodeGlobal (istringstream & in, trie * GlobalSuffixTrie, char lastLette
 	// adds last position difference to index, to get the length of the word
 	index += t1;
 
-	unsigned long long globalIndex = convertToIntLong(in,false)-1;
+	unsigned long long globalIndex = in.number(FIELD_RANK) - 1;
 
 	string guessedWord = start + guessed.str();
 
@@ -160,46 +95,38 @@ string decodeGlobal (istringstream & in, trie * GlobalSuffixTrie, char lastLette
 
 // decodes the first word from in, given that it
 // was encoded using the local dictionary
-string decodeLocal (istringstream & in, mtf * localDictionary) {
-        unsigned long long index = convertToIntLong(in) - 1;
+string decodeLocal (FieldReader & in, mtf * localDictionary) {
+        unsigned long long index = in.number(FIELD_LOCAL) - 1;
 	if(COMMENT) cout << "searching local at index " << index << endl;
 	return localDictionary->word(index);
 }
 
 
 // decodes the first word from in, given that it
-// was compressed with the standard scheme
-string decodeNormal(istringstream & in) {
+// was compressed with the standard scheme, of at most maxChars chars
+string decodeNormal(FieldReader & in, unsigned long long maxChars) {
 	// the length of the word
-	int len = convertToInt(in,false);
+	unsigned long long len = in.number(FIELD_LENGTH);
+	if(len > in.left() || len > maxChars) {
+		in.fail();
+		return "";
+	}
 
 	if(COMMENT) cout << "LEN : " << len << endl;
 
-	// the result
-	ostringstream res;
-
-	// decodes char-by-char
-	while(len > 0){
-		int t = convertToInt(in,false);
-		char c;
-		if(ENCODINGCHARS == 1)  c = intToChar(t);
-		else {
-			if(t == 27) c = ' ';
-			else c = t + 'a' - 1; 
-		}
-		res << c;
-		len--;
-	}
-	
-	return res.str();
+	return in.literals(len);
 }
 
 
-// decodes the first phrase in the binary string in
-string decodePhrase(istringstream & in, trie * GlobalSuffixTrie, mtf * localDictionary){
+// decodes the first phrase in the binary string in, of at most maxChars chars
+string decodePhrase(FieldReader & in, trie * GlobalSuffixTrie, mtf * localDictionary, unsigned long long maxChars){
 
-	// the number of word groups in this phrase
-	int numGroups = convertToInt(in);
+	// the number of word groups in this phrase (each is a char at least)
+	unsigned long long numGroups = in.number(FIELD_GROUPS);
+	if(numGroups > maxChars) {
+		in.fail();
+		return "";
+	}
 
 	if(COMMENT) cout << "# word groups : " << numGroups << endl;
 
@@ -210,41 +137,23 @@ string decodePhrase(istringstream & in, trie * GlobalSuffixTrie, mtf * localDict
 	queue<string> words;
 
 	char lastLetter = '!';
+	unsigned long long length = 0;
 
 	// decodes word group by word group
 	while(numGroups > 0){
-		// reads in the first bit
-		char c;
-		in >> c;
-
 		string result;
 
-		// if the first bit is 0, this word group is encoded
-		// with the global dictionary scheme
-		if(c == '0') result = decodeGlobal(in, GlobalSuffixTrie,lastLetter);
-		else {  // if the first bit is 1
-			c = in.peek();
-
-			// if the first 2 bits are 10 then this word group is encoded
-                	// with the local dictionary scheme
-			if(c == '0') result = decodeLocal(in, localDictionary);
-			else {  // if the first 2 bits are 11
-				in >> c;
-				c = in.peek();
-
-				// if the first 3 bits are 110 then this word group is encoded
-                        	// with the standard scheme
-				if(c == '0'){
-					in >> c;
-					result = decodeNormal(in);
-				} else {
-					// if the first 3 bits are 111 then this word group is encoded
-                                	// with the local dictionary scheme
-					in.putback('1');
-					result = decodeLocal(in, localDictionary);
-				} // if
-			} // if
-		} // if
+		// the scheme this word group is encoded with
+		GroupScheme scheme = in.scheme();
+		unsigned long long room = (length < maxChars) ? maxChars - length : 0;
+		if(scheme == SCHEME_GLOBAL) result = decodeGlobal(in, GlobalSuffixTrie,lastLetter, room);
+		else if(scheme == SCHEME_NORMAL) result = decodeNormal(in, room);
+		else result = decodeLocal(in, localDictionary);
+		length += result.length() + 1;
+		if(in.failed() || result.empty() || length > maxChars + 1) {
+			in.fail();
+			return "";
+		}
                 lastLetter = result[result.length()-1];
 		// adds result to word groups
 		words.push(result);
@@ -279,17 +188,33 @@ string decodePhrase(istringstream & in, trie * GlobalSuffixTrie, mtf * localDict
 }
 
 
+// the number of spaces read from in, if the text still has room for them
+// (fails in otherwise)
+static unsigned long long readSpaces(FieldReader & in, unsigned long long & room){
+	unsigned long long n = in.number(FIELD_SPACES) - 1;
+	if(n > room) {
+		in.fail();
+		return 0;
+	}
+	room -= n;
+	return n;
+}
+
 // recovers spaces from simplified using the bits from in
-// and returns the result
-string addSpaces(string simplified, istringstream & in){
+// and returns the result, of at most maxChars chars
+string addSpaces(string simplified, FieldReader & in, unsigned long long maxChars){
         istringstream read (simplified);
         char c;
-	int n;
+	unsigned long long n;
 
         ostringstream res;
 
+	// the spaces take the place of the ones of simplified, and come on top of
+	// its other chars
+	unsigned long long room = maxChars - (simplified.length() - count(simplified.begin(), simplified.end(), ' '));
+
 	// reads the # spaces at start from in
-        n = convertToInt(in,false) - 1;
+        n = readSpaces(in, room);
         // adds this number of spaces
         while(n > 0){
                 res << ' ';
@@ -306,7 +231,7 @@ string addSpaces(string simplified, istringstream & in){
 			res << c;
 			period = false;
 		} else {  // reads the next number (# spaces before a perido if c == '.') from in
-			n = convertToInt(in,false) - 1;
+			n = readSpaces(in, room);
 			// adds this number of spaces
 			while(n > 0){
 				res << ' ';
@@ -318,7 +243,7 @@ string addSpaces(string simplified, istringstream & in){
 				period = true;
 				res << c;
 				// reads the next number from in
-	                        n = convertToInt(in,false) - 1;
+	                        n = readSpaces(in, room);
         	                // adds this number of spaces
                 	        while(n > 0){
                         	        res << ' ';
@@ -330,7 +255,7 @@ string addSpaces(string simplified, istringstream & in){
 
 	if(!period){
 		// adds spaces at end
-		n = convertToInt(in,false) - 1;
+		n = readSpaces(in, room);
 	        while(n > 0){
 		        res << ' ';
                 	n--;
@@ -343,23 +268,21 @@ string addSpaces(string simplified, istringstream & in){
 
 // recovers upper case letters and commas from simplified using 
 // the bit vector from in and returns the result
-string unsimplify(string simplified, istringstream & in){
+string unsimplify(string simplified, BitReader & in){
 	istringstream read (simplified);
-	char c, n;
+	char c;
 
 	ostringstream res;
 
 	// reads char-by-char
 	while(read.get(c)){
 		// reads next bit from in
-		in >> n;
 		// if bit is 0, does nothing
-		if(n == '0'){
+		if(!in.readBit()){
 			res << c;
 		} else if(c == ' '){
 			// if bit is 1 and c is a space, reads next bit
-			in >> n;
-			if(n == '0') { // if "10" -> comma
+			if(!in.readBit()) { // if "10" -> comma
 				res << ',';
 			} else res << '.';
 		} else {
@@ -373,37 +296,38 @@ string unsimplify(string simplified, istringstream & in){
 }
 
 
-// decodes the entire binary string from in
-string decodeText(istringstream & in, trie * GlobalSuffixTrie){
+// decodes all the fields from in into text, of at most maxChars chars; false
+// if a field claims more than the input (or the text) can hold
+static bool decodeFields(FieldReader & in, trie * GlobalSuffixTrie, unsigned long long maxChars, string & text){
 	// local dictionary
 	mtf * localDictionary = new mtf;
 
 	// the result
 	ostringstream res;
 
-	// gets the first bit
-	char c;
-	in >> c;
-	// if bit is '1', text ends with '.'; otherwise it does not
-	bool dot = (c == '1');
+	// whether text ends with '.'
+	bool dot = in.flag(FIELD_DOT);
 
 	// indicates if this is the initial iteration of the while loop
 	bool start = true;
 
+	// the chars of the phrases so far, with their periods
+	unsigned long long length = 0;
+
 	// decodes phrase by phrase
-	while(in >> c){
-		char t = in.peek();
-		// if reading bit vector
-		if(c == '1' && t == '0') {
-			in >> t;
-			break;
-		} else {// if reading phrase
-			if(start){
-				start = false;
-			} else res << '.';
-			in.putback(c);
-			res << decodePhrase(in, GlobalSuffixTrie, localDictionary);
-		} // if
+	while(!in.failed() && in.flag(FIELD_PHRASE)){
+		if(start){
+			start = false;
+		} else {
+			res << '.';
+			length++;
+		}
+		if(length > maxChars) in.fail();
+		else {
+			string phrase = decodePhrase(in, GlobalSuffixTrie, localDictionary, maxChars - length);
+			res << phrase;
+			length += phrase.length();
+		}
 	} // while
 
 	// adds . if needed at the end
@@ -411,21 +335,39 @@ string decodeText(istringstream & in, trie * GlobalSuffixTrie){
 
 	// simplified result
 	string simplified = res.str();
+	if(in.failed() || simplified.length() > maxChars) {
+		delete localDictionary;
+		return false;
+	}
 
         if(COMMENT) cout << "SIMPLIFIED : \"" << simplified << "\"" << endl;
 
 	// recovers multiple spaces
-	string result = addSpaces(simplified,in);
+	string result = addSpaces(simplified,in,maxChars);
 	if(COMMENT) cout << "ADDED SPACES : \"" << result << "\"" << endl;
 
-	// decodes the rest (a bit vector) with RLE
-	string rleRest = rleDecode(in);
-	istringstream in2(rleRest.c_str());
+	// decodes the rest (a bit vector) with RLE: unsimplify reads a bit for each
+	// char, and two for some spaces
+	BitWriter rleRest = rleDecode(in, 2 * result.length());
+	string packed = rleRest.bytes();
+	BitReader in2(packed, rleRest.size());
 
 	// recovers upper-case letters and commas
-	result = unsimplify(result,in2);
+	text = unsimplify(result,in2);
 	
 	delete localDictionary;
 
-	return result;
+	return !in.failed();
+}
+
+
+bool decodeText(BitReader & in, trie * GlobalSuffixTrie, const CharCodec & chars, unsigned long long maxChars, string & text){
+	GammaFieldReader fields(in, chars);
+	return decodeFields(fields, GlobalSuffixTrie, maxChars, text);
+}
+
+bool decodeRangeCoded(const unsigned char * data, unsigned long long size, trie * GlobalSuffixTrie, unsigned long long maxChars,
+	string & text){
+	RangeFieldReader fields(data, size);
+	return decodeFields(fields, GlobalSuffixTrie, maxChars, text);
 }
@@ -3,7 +3,28 @@
 #include <string>
 #include <iostream>
 #include "suffix_trie.h"
+#include "bitstream.h"
+#include "chars.h"
 
-std::string decodeText(std::istringstream & in, trie * GlobalSuffixTrie);
+// prints the fields as they are decoded; each thread has its own, so a thread
+// can decode quietly while another does not
+extern bool COMMENT;
+#pragma omp threadprivate(COMMENT)
+
+// the most chars a compressed file decodes to, unless its decoder is given
+// fewer (as a block of a stream, or a request of the server): whatever lengths a
+// broken file claims, the decoder never holds more
+#define DECODE_MAX_CHARS (1ULL << 31)
+
+// decodes the bits of the gamma format, from the encoder, with the char codes
+// of the scheme they were encoded with, into text of at most maxChars chars;
+// false if the bits are broken (a length in them is more than the bits left,
+// or than the text can hold)
+bool decodeText(BitReader & in, trie * GlobalSuffixTrie, const CharCodec & chars, unsigned long long maxChars, std::string & text);
+
+// decodes the size bytes of the range format at data (see fields.h), as
+// decodeText
+bool decodeRangeCoded(const unsigned char * data, unsigned long long size, trie * GlobalSuffixTrie, unsigned long long maxChars,
+	std::string & text);
 
 #endif
@@ -3,64 +3,65 @@
 #include <vector>
 #include <queue>
 #include <iomanip>
+#include <map>
 #include <sstream>
+#include <cstring>
+#include <algorithm>
 #include "encode.h"
 #include "mtf.h"
 #include "wordclass.h"
+#include "global_cache.h"
+#include "normalize.h"
+#include "fields.h"
 
 using namespace std;
 
-// LEVEL OF OUTPUT COMMENTS:
-bool REPORT = false;  // very detailed
-bool SUMMARY = true; // some details
-bool END = true;     // few details
-bool STATS = true;    // statistics about optimum wordgroup/guess combinations
-
-
-// bounds for revealed chars
-int MAX_NUM_REVEALED_CHARS = 4;
-int MAX_NUM_WORDS = 5;
-
-// For Statistics:
-int MAX_SIZE = 1000;
-int numWordGroups[1000];
-int numWordsInGroup[1000];
-int numberLetters[1000];
-
-// normal = 0, local = 1, global = 2
-int schemes[3];
-
-// initializes statistics (everything has count 0)
-void initializeStats(){
-	for(int j = 0; j < MAX_SIZE; j++){
-		numberLetters[j] = 0;
-		numWordsInGroup[j] = 0;
-		numWordGroups[j] = 0;
+EncodeOptions::EncodeOptions():
+	encodingChars(0), huffman(NULL), segmentation(0), maxWords(5), maxRevealedChars(4),
+	report(false), summary(false), end(false), stats(false), cache(NULL) {}
+
+// For Statistics (of one compression):
+#define MAX_SIZE 1000
+struct Statistics {
+	int numWordGroups[MAX_SIZE];
+	int numWordsInGroup[MAX_SIZE];
+	int numberLetters[MAX_SIZE];
+
+	// normal = 0, local = 1, global = 2
+	int schemes[3];
+
+	// initializes statistics (everything has count 0)
+	Statistics(){
+		for(int j = 0; j < MAX_SIZE; j++){
+			numberLetters[j] = 0;
+			numWordsInGroup[j] = 0;
+			numWordGroups[j] = 0;
+		}
+		schemes[0] = 0;
+		schemes[1] = 0;
+		schemes[2] = 0;
 	}
-	schemes[0] = 0;
-	schemes[1] = 0;
-	schemes[2] = 0;
-}
+};
 
 // prints all statistics
-void printStats(){
+void printStats(const Statistics & stats){
 	cout << endl << "*****************************************\nSTATS: " << endl;
 	cout << "num word groups: " << endl;
         for(int j = 1; j < MAX_SIZE; j++){
-                if(numWordGroups[j] != 0) cout << j << " word groups: " << numWordGroups[j] << " times" << endl;
+                if(stats.numWordGroups[j] != 0) cout << j << " word groups: " << stats.numWordGroups[j] << " times" << endl;
         }
         cout << endl << "num words in word groups: " << endl;
         for(int j = 1; j < MAX_SIZE; j++){
-                if(numWordsInGroup[j] != 0) cout << j << " words in a word group: " << numWordsInGroup[j] << " times" << endl;
+                if(stats.numWordsInGroup[j] != 0) cout << j << " words in a word group: " << stats.numWordsInGroup[j] << " times" << endl;
         }
         cout << endl << "num letters: " << endl;
         for(int j = 1; j < MAX_SIZE; j++){
-                if(numberLetters[j] != 0) cout << j << " letters: " << numberLetters[j] << " times" << endl;
+                if(stats.numberLetters[j] != 0) cout << j << " letters: " << stats.numberLetters[j] << " times" << endl;
         }
 	cout << endl << "schemes used:" << endl;
-	cout << "NORMAL: " << schemes[0] << " times" << endl;
-        cout << "LOCAL : " << schemes[1] << " times" << endl;
-        cout << "GLOBAL: " << schemes[2] << " times" << endl;
+	cout << "NORMAL: " << stats.schemes[0] << " times" << endl;
+        cout << "LOCAL : " << stats.schemes[1] << " times" << endl;
+        cout << "GLOBAL: " << stats.schemes[2] << " times" << endl;
 
 	cout << "***************************************************" << endl << endl;
 }
@@ -69,96 +70,85 @@ void printStats(){
 
 
 
-vector<int> position;
-vector<int> combination;
-vector< vector<int> > combinationList;
-vector< vector<int> > combinationLetters;
-
-// recursively adds combinations to the result, stored in combinationList
-void recursiveCombinations(int offset, int k, bool splits) {
+// recursively adds the combinations of k items of position, from offset on, to result
+void recursiveCombinations(const vector<int> & position, vector<int> & combination, unsigned int offset, int k, vector< vector<int> > & result) {
         if (k == 0) {
-		if(splits) combinationList.push_back(combination);
-		else combinationLetters.push_back(combination);
+		result.push_back(combination);
                 return;
         }
 	unsigned int end = position.size() - k;
         for (unsigned int i = offset; i <= end; ++i) {
             combination.push_back(position[i]);
-            recursiveCombinations(i+1, k-1, splits);
+            recursiveCombinations(position, combination, i+1, k-1, result);
             combination.pop_back();
         }
 }
 
-// finds all combinations of k items chosen from n items
-// and stores the result in combinationList
-void findAllCombinations(int n, int k, bool splits = true){
-
-	position.clear();
-	combination.clear();
+// returns all combinations of k items chosen from n items (numbered from 1),
+// in lexicographic order
+vector< vector<int> > findAllCombinations(int n, int k){
+	vector<int> position;
+	vector<int> combination;
+	vector< vector<int> > result;
 	for (int i = 0; i < n; ++i) { 
 		position.push_back(i+1); 
 	}
-        recursiveCombinations(0, k, splits);
+        recursiveCombinations(position, combination, 0, k, result);
+	return result;
 }
 
 
-// returns the compressed string for
-// text if the standard (char-by-char) compression scheme is used
-string normalCompression(string text){
-	const char * word = text.c_str();
+// the number of bits of the standard (char-by-char) compression of the len
+// chars at text, with the char codes chars: "110", the length, then the chars
+unsigned int normalLength(const char * text, unsigned int len, const CharCodec & chars){
+	return 3 + gammaLength(len, false) + chars.charsLength(text, len);
+}
+
+// returns the compressed bits for
+// text if the standard (char-by-char) compression scheme is used, with the char codes chars
+BitWriter normalCompression(string text, const CharCodec & chars, const EncodeOptions & options){
 	unsigned int len = text.length();
 
-        // compressed string
-        string compressed = "110" + convertToBinary(len,false);
+        // compressed bits: "110" then the length
+        BitWriter compressed;
+        compressed.write(6, 3);
+        writeGamma(compressed, len, false);
 
 	// adds compressed characters to compressed
-	for(unsigned int i = 0; i < len; i++){
-		int c;
-		if(ENCODINGCHARS == 1) c = charToInt(word[i]);
-		else {
-			c = word[i] - 'a' + 1;
-			if(word[i] == ' ') c = 27;
-			else if(word[i] == '.') c = 28; 
-		}
-		string t = convertToBinary(c,false);
-		compressed += t;
-	}
-	if(REPORT) cout << "NORMAL : "<< compressed << endl;
+	chars.writeChars(compressed, text);
+	if(options.report) cout << "NORMAL : "<< compressed.text() << endl;
 	return compressed;
 }
 
+// the compressed bits of the index localRes of the local dictionary: "1" indicates
+// the local dictionary is used
+BitWriter localCompression(unsigned long long localRes){
+	BitWriter localCompressed;
+	localCompressed.writeBit(1);
+	writeGamma(localCompressed, localRes + 1);
+	return localCompressed;
+}
 
-// searches for text in the local dictionary and returns
-// the corresponding CompressedWords *
+// searches for text in the local dictionary: returns the ratio of its compression
+// (-1 if it is not there), with its index and the length of its bits
 // normalLen is the length of the compressed string under the standard scheme
-CompressedWords * tryLocalDict(string text, int normalLen, mtf * localDictionary){
-	// compressed version of this phrase using local dict
-        CompressedWords * bestWord = new CompressedWords;
-
-        bestWord->words = text;
-
+float tryLocalDict(const string & text, int normalLen, mtf * localDictionary, const EncodeOptions & options,
+		unsigned long long & localRes, int & localLen){
         // determines index using local Dictionary
-        unsigned long long localRes = localDictionary->index(text);
-
-        string localCompressed = "";
+        localRes = localDictionary->index(text);
+        localLen = 0;
         float localRatio = -1.0;
 
-
-	// if text is found in local dictionary, determine localCompressed
+	// if text is found in local dictionary, its bits are "1" then the index + 1
         if(localRes != 0xffffffff){
-		// "1" indicates local dict is used
-        	localCompressed = "1" + convertToBinaryLong(localRes + 1);
-                int localLen = localCompressed.length();
+                localLen = 1 + gammaLength(localRes + 1);
                 localRatio = 100.0 * localLen / normalLen; 
-                if(REPORT) cout << "LOCAL (FOR \"" << text << "\"): localRes = " << localRes << " , localCompressed = " << localCompressed
+                if(options.report) cout << "LOCAL (FOR \"" << text << "\"): localRes = " << localRes << " , localCompressed = " << localCompression(localRes).text()
                                 << " , localLen = " << localLen << " , localRatio = " << fixed << setw(7) << setprecision(3) << localRatio << endl;
-		else if(SUMMARY) cout <<  "LOCAL (FOR " << text << "): localRes = " << localRes << " , localCompressed = " << localCompressed
+		else if(options.summary) cout <<  "LOCAL (FOR " << text << "): localRes = " << localRes << " , localCompressed = " << localCompression(localRes).text()
 				<< " , localRatio = " << fixed << setw(7) << setprecision(3) << localRatio << endl;
-        } else if (REPORT || SUMMARY) cout << "NOT FOUND IN LOCAL DICTIONARY" << endl;
-        bestWord->compressedString = localCompressed;
-        bestWord->ratio = localRatio;
-        bestWord->usesLocalDict = (localRes != 0xffffffff);
-	return bestWord;
+        } else if (options.report || options.summary) cout << "NOT FOUND IN LOCAL DICTIONARY" << endl;
+	return localRatio;
 }
 
 
@@ -167,7 +157,8 @@ CompressedWords * tryLocalDict(string text, int normalLen, mtf * localDictionary
 // normalLen is the length of the compressed string for text using standard scheme
 // lastLetter is the last letter of the prev word is text is not the start of a phrase, or else
 // it is '!'
-CompressedWords * tryAllLetters(string text, int normalLen, trie * GlobalSuffixTrie, char lastLetter) {
+CompressedWords * tryAllLetters(string text, int normalLen, trie * GlobalSuffixTrie, char lastLetter, const CharCodec & chars,
+		const EncodeOptions & options) {
 	// the result
         CompressedWords * bestWord = new CompressedWords;
 
@@ -179,11 +170,21 @@ CompressedWords * tryAllLetters(string text, int normalLen, trie * GlobalSuffixT
 		if(text[q] == ' ') Spaces++;
         }
 
-	if(Spaces + 1 > MAX_NUM_WORDS) { // MAX NUMBER OF WORDS CONSIDERED
-		bestWord->ratio = -1; cout << "Too many words" << endl;
+	if(Spaces + 1 > options.maxWords) { // MAX NUMBER OF WORDS CONSIDERED
+		bestWord->ratio = -1; if(options.report || options.summary) cout << "Too many words" << endl;
 		return bestWord;
 	}	
 
+	// the trie only holds the letters and ' ': nothing else can be found (nor
+	// looked up), in text or as the last letter
+	for(int q = -1; q < t; q++){
+		char c = (q < 0) ? (lastLetter == '!' ? 'a' : lastLetter) : text[q];
+		if((c < 'a' || c > 'z') && c != ' ') {
+			bestWord->ratio = -1; if(options.report || options.summary) cout << "Not in the trie" << endl;
+			return bestWord;
+		}
+	}
+
 	// length of text
 	int len = text.length();	
 
@@ -191,69 +192,72 @@ CompressedWords * tryAllLetters(string text, int normalLen, trie * GlobalSuffixT
 
 	// text as an array
 	const char * words = text.c_str();
-	int Bound = (len <=  MAX_NUM_REVEALED_CHARS) ? len - 1 :  MAX_NUM_REVEALED_CHARS; // MAX NUMBER OF REVEALED CHARS CONSIDERED
+	int Bound = (len <=  options.maxRevealedChars) ? len - 1 :  options.maxRevealedChars; // MAX NUMBER OF REVEALED CHARS CONSIDERED
 	// for every possible number of revealed chars (ranging from 1 to len)
         for(int q = 1; !exitEarly && q <= Bound; q++){
-		if(REPORT) cout << "   FINDING LETTERS ; len: " << len << ", q: " << q << endl;
-		// finds all combinations of choosing q items from len items, and stores it in
-		// combinationLetters
-                findAllCombinations(len, q, false);
+		if(options.report) cout << "   FINDING LETTERS ; len: " << len << ", q: " << q << endl;
+		// finds all combinations of choosing q items from len items
+                vector< vector<int> > combinationLetters = findAllCombinations(len, q);
 
-                // for each combination
-		#pragma omp parallel for
+                // the revealed positions of each combination, and the others (don't cares)
+                vector < vector <int> > revealedList(combinationLetters.size());
+		vector < queue <unsigned int> > revealedQueueList(combinationLetters.size());
 		for(unsigned int ITERAT = 0; ITERAT < combinationLetters.size(); ITERAT++){
-			if(REPORT) cout << "     Letters: " << endl << "     ";
-
-                        // positions of revealed chars in ascending order
-                        vector <int> currentRevealed;
-			queue <unsigned int> currentRevealedQueue;
+			if(options.report) cout << "     Letters: " << endl << "     ";
 
 			// stores the chars corresponding to the positions given by the 
-			// current combination in currentRevealed
-			// and indices of non-revealed chars in currentRevealedQueue
+			// current combination in revealedList
+			// and indices of non-revealed chars in revealedQueueList
 			int ind = 0;
                         for(vector <int>::iterator iterat = (combinationLetters[ITERAT]).begin(); iterat != (combinationLetters[ITERAT]).end(); iterat++){
 				for(int j = ind; j < (*iterat)-1; j++){
-					currentRevealedQueue.push(j);
+					revealedQueueList[ITERAT].push(j);
 				}
 				ind = (*iterat);
-				if(REPORT) cout << words[(*iterat)-1] << " , ";
-                                currentRevealed.push_back((*iterat)-1);
+				if(options.report) cout << words[(*iterat)-1] << " , ";
+                                revealedList[ITERAT].push_back((*iterat)-1);
                         }
-			if(REPORT) cout << endl;
+			if(options.report) cout << endl;
 
                         for(int j = ind; j < len; j++){
-                        	currentRevealedQueue.push(j);
+                        	revealedQueueList[ITERAT].push(j);
 			}
-			
-			// the index given by searching for text in the suffix tree using currentRevealed
+		}
 
-			long long globalRes;
+		// the indices given by searching for text in the suffix tree, for all the
+		// combinations at once (they share most of the search)
+		vector <long long> globalRanks;
+                if(lastLetter != '!') {
+			// the text with the last letter added to the front
+        	        ostringstream tmp;
+                	tmp << lastLetter << " " << text;
+	                string newText = tmp.str();
+			// searches suffix trie for newText
+			globalRanks = GlobalSuffixTrie->get_ranks(newText, revealedQueueList, true);
+		} else globalRanks = GlobalSuffixTrie->get_ranks(text, revealedQueueList);
 
-                        if(lastLetter != '!') {
-				// the text with the last letter added to the front
-        	                ostringstream tmp;
-                	        tmp << lastLetter << " " << text;
-	                        string newText = tmp.str();
-				// searches suffix trie for newText
-				globalRes = GlobalSuffixTrie->get_rank(newText, currentRevealedQueue,true);
-			} else globalRes = GlobalSuffixTrie->get_rank(text, currentRevealedQueue);
+                // for each combination
+		for(unsigned int ITERAT = 0; ITERAT < combinationLetters.size(); ITERAT++){
+                        // positions of revealed chars in ascending order
+                        vector <int> &currentRevealed = revealedList[ITERAT];
 
+			long long globalRes = globalRanks[ITERAT];
 
 			// if text is not found in global dictionary, done (return bestWord, with ratio -1)
 			if(globalRes == -1) {
-				if(REPORT) cout << text << " NOT FOUND in global dictionary => DONE " << endl;
+				if(options.report) cout << text << " NOT FOUND in global dictionary => DONE " << endl;
 				//combinationLetters.clear();
 				//return bestWord;
 				exitEarly = true;
 			} 
 
 			if(!exitEarly){
-				// the string storing the compressed result for this combination
-				// first stores the # of reveals
-				string rev = convertToBinary(q);
-                        	string globalCompressed = rev;
-				if(REPORT) cout << " # reveals : " << rev << " (" << q << ")"<< endl;
+				// the bits storing the compressed result for this combination
+				// first stores "0" to indicate the global dictionary is used, and the # of reveals
+                        	BitWriter globalCompressed;
+                        	globalCompressed.writeBit(0);
+				writeGamma(globalCompressed, q);
+				if(options.report) cout << " # reveals : " << q << endl;
 
 				// previous position guessed
                 	        int prev = 0;
@@ -263,544 +267,546 @@ CompressedWords * tryAllLetters(string text, int normalLen, trie * GlobalSuffixT
                 	        for(vector<int>::iterator IT = currentRevealed.begin(); IT != currentRevealed.end(); IT++){
 					// current revealed char is encoded
                         		char revealChar = words[(*IT)];
-					int revealInt;
-					if(ENCODINGCHARS == 1) revealInt = charToInt(revealChar);
-					else {
-	                	                if(revealChar == ' ') revealInt = 27; 
-        	                	        else revealInt = revealChar - 'a' + 1;
-					}
-
-					string t1 = convertToBinary((*IT) - prev + 1, false);
-					string t2 = convertToBinary(revealInt, false);
-
-					if(REPORT) cout << "  adding " << t1 << " (" << (*IT) - prev + 1 << ") + " << t2 << " (" << revealInt << ")" << endl;
-					// adds position difference and char to string
-                                	globalCompressed = globalCompressed + t1 + t2;
+
+					if(options.report) cout << "  adding " << (*IT) - prev + 1 << " + " << revealChar << endl;
+					// adds position difference and char
+					writeGamma(globalCompressed, (*IT) - prev + 1, false);
+					chars.writeChar(globalCompressed, revealChar);
 	                                prev = (*IT) + 1;
         	                } // for
 
-				// adds the difference to the end of phrase and globalRes to the end of the string, and "0" 
-				// to the start of the string to indicate the global dicitionary is used
-
-				string t1 = convertToBinary(len - prev + 1, false);
-				string t2 = convertToBinaryLong(globalRes+1,false);
+				// adds the difference to the end of phrase and globalRes
+				if(options.report) cout << "  end: " << len - prev + 1 << " + index " << globalRes << " + 1" << endl;
+				writeGamma(globalCompressed, len - prev + 1, false);
+				writeGamma(globalCompressed, globalRes + 1, false);
 
-				if(REPORT) cout << "  end: " << t1 << " (" << len - prev + 1 << ") + index " << t2 << " (" << globalRes << " + 1)" << endl;
-                        	globalCompressed = "0" + globalCompressed + t1 + t2; 
-
-				// length of the compressed string
-        	                int globalLen = globalCompressed.length();
+				// length of the compressed bits
+        	                int globalLen = globalCompressed.size();
 				// ratio
                         	float globalRatio = 100.0 * globalLen / normalLen;
 
-				if(REPORT) cout << "GLOBAL: globalRes = " << globalRes << " , globalCompressed = " << globalCompressed << endl << "  normalLen = " << normalLen 
+				if(options.report) cout << "GLOBAL: globalRes = " << globalRes << " , globalCompressed = " << globalCompressed.text() << endl << "  normalLen = " << normalLen 
 						<< " , globalLen = " << globalLen << " , globalRatio = " << fixed << setw(7) << setprecision(3) << globalRatio << endl;
 
 				// if the ratio for this combination is better than the best ratio so far, or 
 				// this is the first combination of revealed chars tried, stores this combination
 				// in bestWord
         	                if(bestWord->ratio > globalRatio || bestWord->ratio == -1) {
-                	        	if(REPORT) cout << "OLD RATIO: " << bestWord->ratio << " worse than new ratio: "<< globalRatio << endl;
-                        	        bestWord->compressedString = globalCompressed;
+                	        	if(options.report) cout << "OLD RATIO: " << bestWord->ratio << " worse than new ratio: "<< globalRatio << endl;
+                        	        bestWord->compressedBits = globalCompressed;
                                 	bestWord->ratio = globalRatio;
 	                                bestWord->usesLocalDict = false;
         	                        bestWord->revealedChars = currentRevealed;
 					bestWord->numLetters = currentRevealed.size();
+					bestWord->index = globalRes;
                         	} // if
 			} // if
                 } // for
-
-                combinationLetters.clear();
 	} // for
 
 	// prints best combination
-	if(SUMMARY && !exitEarly) {
-		cout << "***" << endl << "BEST REVEAL FOR \"" << text << "\": " << bestWord->compressedString << " (ratio " << bestWord->ratio << "); guess : ";
+	if(options.summary && !exitEarly) {
+		cout << "***" << endl << "BEST REVEAL FOR \"" << text << "\": " << bestWord->compressedBits.text() << " (ratio " << bestWord->ratio << "); guess : ";
+		// the revealed chars are kept, as the fields are written from them
+		unsigned int r = 0;
 		for(int i = 0; i < len; i++){
-			if(bestWord->revealedChars.size() != 0 && bestWord->revealedChars[0] == i){
+			if(r < bestWord->revealedChars.size() && bestWord->revealedChars[r] == i){
 				cout << words[i];
-				bestWord->revealedChars.erase(bestWord->revealedChars.begin());
+				r++;
 			} else cout << "_ ";
 		} 
 		cout << endl << "***" << endl;
 	}
-	if(!exitEarly) bestWord->prevLetter = lastLetter;
+	// the context is set even if text was not found, as the result depends on it
+	bestWord->prevLetter = lastLetter;
 	return bestWord;
 }
 
 
-// simplifies text (makes it all lower case, and removes commas)
-// return (simplified text, bitVector) pair
-pair <string,string> simplifyText(string text){
-	string bitVector = "";
-
-	istringstream in (text);
-
-	ostringstream out;
-
-	char c;
-	// has there been any letter since the last period?
-	bool lastPeriod = true;
-
-	// reads text char-by-char
-	while(in.get(c)){
-		if(((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) && lastPeriod) lastPeriod = false;
-
-		// indicates comma is "10"
-		if(c == ',') {
-			bitVector += "10";
-			out << ' ';
-		} else if(c >= 'A' && c <= 'Z') {
-			// indicates upper case with "1"
-			bitVector += "1";
-			char t = c - 'A' + 'a';
-			out << t;
-		} else if(c == '.'){
-			if(!lastPeriod) {
-				// if first period, does nothing
-				lastPeriod = true;
-	                        bitVector += "0";
-        	                out << c;
-			} else {
-				// if this is a period in a series of periods (with no letter between)
-				// indicates it by "11", and transforms it into a space
-				bitVector += "11";
-				out << ' ';
-			} // else
-		} else {
-			bitVector += "0";
-			out << c;
-		} // else
-	} // while
-
-	string simplified = out.str();
-
-	if(REPORT) cout << "SIMPLIFIED \"" << text << "\" to \"" << simplified << "\" with bit vector " << bitVector << endl;
-
-	pair <string, string> p;
-	p.first = simplified;
-	p.second = bitVector;
-
-	return p;
-}
-
-
-// removes multiple spaces in text 
-// returns (simplified text, set of # of spaces) pair
-pair <string,string> removeSpaces(string text){
-        string bits = "";
-
-        istringstream in (text);
-
-        ostringstream out;
-
-        char c;
-	
-	// last char was space
-	bool space = false;
-	int numSpaces = 0;
-
-	// if the last non-space char was a period or start of text
-	bool period = true;
-
-	bool newLine = false;
+// a group of words of a phrase, given the last letter of the group before it
+// ('!' at the start of a phrase): a view of the words in the text of the phrase,
+// ordered as the words, then the letter
+struct GroupKey {
+	const char * words;
+	unsigned int length;
+	char lastLetter;
+	bool operator < (const GroupKey & other) const {
+		int c = memcmp(words, other.words, min(length, other.length));
+		if(c != 0) return c < 0;
+		if(length != other.length) return length < other.length;
+		return lastLetter < other.lastLetter;
+	}
+};
+
+// the best global dictionary compression of each group of words
+typedef map< GroupKey, CompressedWords * > GlobalCandidates;
+
+// a phrase (without '.'), or a part of one (see splitPhrases), and the indices
+// at which its words start
+struct Phrase {
+	string text;
+	vector<int> starts;
+	// the last letter before it: '!' at the start of a phrase, otherwise the
+	// last letter of the part before it
+	char lastLetter;
+	// whether the phrase goes on in the next part
+	bool more;
+	// the best global compression of each group of words i to j - 1 of at most
+	// options.maxWords words, for i from 0 and j from i + 1 (see
+	// findGlobalCandidates): the trie is not searched for the longer groups
+	vector<const CompressedWords *> global;
+};
+
+// splits text (simplified, without multiple spaces) into its phrases, up to bound
+// (the last index in text that is not the final '.'). A phrase of more than
+// PHRASE_MAX_WORDS words (as in a text without periods) is split into parts of
+// that many words, which are segmented one after the other, as segmentPhrase
+// takes a time cubic in the words; their groups are written as one phrase
+vector<Phrase> splitPhrases(const string & text, int bound){
+	vector<Phrase> phrases;
+
+	// start of phrase in text
+	int s = 0;
+	while (s < bound) {
+		// finds the end of this phrase (either '.' or the end of text)
+		int temp = s;
+		while(text[temp] != '.' && temp < bound) temp++;
+
+		char lastLetter = '!';
+		bool more = true;
+		for(int start = s; more; ){
+			Phrase P;
+			P.lastLetter = lastLetter;
+			P.starts.push_back(0);
+
+			// the next word starts after each space, up to the space that
+			// ends the part
+			int end = start;
+			for(; end < temp; end++){
+				if(text[end] != ' ') continue;
+				if(P.starts.size() == PHRASE_MAX_WORDS) break;
+				P.starts.push_back(end - start + 1);
+			}
+			P.text = text.substr(start, end - start);
+			more = P.more = end < temp;
+			phrases.push_back(P);
 
-        // reads text char-by-char
-        while(in.get(c)){
-		if(c == '\n' && !newLine){
-			newLine = true;
-			continue;
-		} else if(c != '\n' && newLine) newLine = false;
+			if(more) lastLetter = text[end - 1];
+			start = end + 1;
+		}
 
-                if(c != ' ' && ! space) {
+		s = temp + 1;
+	}
+	return phrases;
+}
 
-			if(period) {
-	                        // stores # of spaces
-        	                bits += convertToBinary(numSpaces + 1,false);
-                	        numSpaces = 0;
+// finds the best global dictionary compression of every group of words of the
+// phrases, in parallel: it only depends on the group and its last letter, not on
+// the local dictionary, so each is found once and the phrases can be encoded in order later.
+// The keys point into the phrases, which must not change until candidates is deleted
+void findGlobalCandidates(vector<Phrase> & phrases, trie * GlobalSuffixTrie, const CharCodec & chars, GlobalCandidates & candidates,
+		const EncodeOptions & options){
+	// the distinct groups, in the order they first appear, and the entry of each
+	// group of each phrase: only the groups of at most options.maxWords words, as
+	// tryAllLetters finds nothing for the others
+	vector<GlobalCandidates::iterator> keys;
+	vector< vector<const GlobalCandidates::value_type *> > entries(phrases.size());
+	for(unsigned int p = 0; p < phrases.size(); p++){
+		const Phrase & P = phrases[p];
+		int m = P.starts.size();
+		for(int i = 0; i < m; i++){
+			char lastLetter = (i == 0) ? P.lastLetter : P.text[P.starts[i] - 2];
+			for(int j = i + 1; j <= m && j - i <= options.maxWords; j++){
+				int end = (j == m) ? P.text.length() : P.starts[j] - 1;
+				GroupKey key = {P.text.data() + P.starts[i], (unsigned int) (end - P.starts[i]), lastLetter};
+				pair<GlobalCandidates::iterator, bool> entry = candidates.insert(make_pair(key, (CompressedWords *) NULL));
+				if(entry.second) keys.push_back(entry.first);
+				entries[p].push_back(&*entry.first);
 			}
+		}
+	}
 
-			// if c is not a space and prev char was not a space, outputs c
-			out << c;
-			// if c is a period, stores the number of spaces before it, 0
-			if(c == '.') {
-				bits += convertToBinary(1,false);
-				period = true;
-			} else period = false;
-		} else if(c != ' ' && space) {
-			// if c is not a space, but last char was a space
-			space = false;
-
-			// if c is a period, no space is outputted; otherwise outputs 1 space
-			if (c == '.' || period) out << c;
-			else out << ' ' << c;
-
-			if(c!='.') period = false;
-			else period = true;
-
-			// stores # of spaces
-			bits += convertToBinary(numSpaces + 1,false);
-			numSpaces = 0;
-		} else { 
-			// if c is a space, increments # spaces
-			space = true;
-			numSpaces++;
-		} // if
-        } // while
-
-	// stores # of spaces at the end
-	if(space) {
-		bits += convertToBinary(numSpaces + 1,false);
-	} else bits += convertToBinary(1,false);
-
-        string simplified = out.str();
-
-	// if text is only spaces, stores "spaces at end" (i.e. 0)
-	if(simplified == "") bits+= convertToBinary(1,false);
-
-        if(REPORT) cout << "SIMPLIFIED SPACES: \"" << text << "\" to \"" << simplified << "\" with bits " << bits << endl;
-
-        pair <string, string> p;
-        p.first = simplified;
-        p.second = bits;
-
-        return p;
+	// the results found for other documents are in options.cache, under the same trie
+	// (and Huffman codes)
+	unsigned long long fingerprint = options.cache ? GlobalSuffixTrie->fingerprint() ^ chars.fingerprint() : 0;
+	unsigned long long hits = options.cache ? options.cache->hits() : 0;
+
+	// the map is not changed here, only the values its entries point to
+	int numKeys = keys.size();
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i < numKeys; i++){
+		string group(keys[i]->first.words, keys[i]->first.length);
+		GlobalCacheKey key;
+		key.group = group;
+		key.prevLetter = keys[i]->first.lastLetter;
+		key.encodingChars = chars.scheme();
+		key.fingerprint = fingerprint;
+
+		CompressedWords * best = new CompressedWords;
+		if(options.cache == NULL || !options.cache->find(key, *best)){
+			delete best;
+			best = tryAllLetters(group, normalLength(group.data(), group.length(), chars), GlobalSuffixTrie, key.prevLetter, chars, options);
+			if(options.cache) options.cache->insert(key, *best);
+		}
+		keys[i]->second = best;
+	}
+	for(unsigned int p = 0; p < phrases.size(); p++)
+		for(unsigned int k = 0; k < entries[p].size(); k++) phrases[p].global.push_back(entries[p][k]->second);
+	if(options.summary) cout << "Found the global compression of " << numKeys << " word groups" << endl;
+	if(options.cache && (options.summary || options.stats)) cout << "Global cache: " << options.cache->hits() - hits << " of them cached, "
+		<< options.cache->size() << " entries, " << options.cache->hits() << " hits, " << options.cache->misses() << " misses, "
+		<< options.cache->evictions() << " evictions" << endl;
 }
 
 
-
-// returns the binary string for the best compression of text
-string bestCompression (string text, trie * GlobalSuffixTrie){
-
-	initializeStats();
-
-	mtf * localDictionary = new mtf;
-	mtf * CPlocalDictionary = new mtf;
-
-	// final binary string, for text
-	string finalRes = "";
-
-	// simplifies text
-	pair <string, string> p = simplifyText(text);
-	text = p.first;
-	string bits = p.second;
-
-	// encodes bit vector with RLE
-	istringstream bitV(bits.c_str());
-	bits = rleEncode(bitV);
-
-	// removes extra spaces from text
-	p = removeSpaces(text);
-        text = p.first;
-        string bitVector = p.second + bits;
-
-	// normal encoding for the entire text
-	string normalEncod = normalCompression(text) + bitVector;
-
-	int n = text.length();
-	const char * T = text.c_str();
-
-	// start of phrase in T
-	int s = 0;
-
-	// the last index in T that holds a letter (not '.')
-	int bound;
-
-	// indicates whether text ends with '.' ("1") or not;
-	// in the latter case, indicates whether text ends with ' ' ("01") or not ("00")
-	string dot;
-	if(T[n-1] == '.') {
-		bound = n - 1;
-		dot = "1";
+// a way to compress the group of words i to j - 1 of a phrase, while the phrase
+// is segmented: a view of its words in the phrase, and the cost of its bits, so
+// that nothing is written (or copied) for the groups that are not chosen
+struct GroupCandidate {
+	const char * words;
+	unsigned int length;
+	// "GLOBAL", "LOCAL" or "NORMAL" (see CompressedWords::encodingScheme)
+	const char * scheme;
+	unsigned int bits;
+	float ratio;
+	// what the bits are made from: the index in the local dictionary, or the
+	// global compression
+	unsigned long long localRes;
+	const CompressedWords * global;
+};
+
+// the scratch space of segmentPhrase, kept from phrase to phrase, so that its
+// buffers are only allocated for the longest phrase: the candidates of all the
+// groups of words of the phrase, and the tables of the dynamic programming
+struct SegmentArena {
+	// the number of words + 1; the entries of i (or k) and j are at [i * width + j]
+	int width;
+	vector<GroupCandidate> groups;
+	vector<float> cost;
+	vector<int> from;
+	// the cost of each group, at [j * width + i], so that the groups ending at j are together
+	vector<float> groupCost;
+	// order[k][j]: the position of groupStarts(k, j) among the splits of row k,
+	// in the order of their starts (the same starts, the same position)
+	vector<int> order;
+	// the splits of a row, with what they are ordered by
+	vector< pair< pair<int, int>, int > > row;
+	// the bits of the chars of the phrase before each index
+	vector<unsigned int> charBits;
+	// the group looked up in the local dictionary
+	string key;
+
+	void reset(int m){
+		width = m + 1;
+		groups.resize(width * width);
+		cost.assign(width * width, 0);
+		from.assign(width * width, -1);
+		groupCost.resize(width * width);
+		order.assign(width * width, 0);
+	}
+	GroupCandidate & group(int i, int j) { return groups[i * width + j]; }
+};
+
+// the compressed group of words of a candidate
+CompressedWords * compressedGroup(const GroupCandidate & group, const CharCodec & chars){
+	if(group.scheme[0] == 'G') {
+		CompressedWords * result = new CompressedWords(*group.global);
+		result->encodingScheme = group.scheme;
+		return result;
+	}
+	CompressedWords * result = new CompressedWords;
+	result->words.assign(group.words, group.length);
+	result->usesLocalDict = group.localRes != 0xffffffff;
+	result->ratio = group.ratio;
+	result->encodingScheme = group.scheme;
+	if(group.scheme[0] == 'L') {
+		result->compressedBits = localCompression(group.localRes);
+		result->index = group.localRes;
 	} else {
-		bound = n;
-		dot = "0";
+		result->compressedBits.write(6, 3);
+		writeGamma(result->compressedBits, group.length, false);
+		chars.writeChars(result->compressedBits, result->words);
 	}
+	return result;
+}
 
+// finds the best compression of the group of words at words (with the global
+// compression bestGl, from findGlobalCandidates, or NULL if there is none): the
+// global dictionary, the local dictionary, or the standard scheme, whose bits
+// are normalLen long
+void compressGroup(const char * words, unsigned int length, const CompressedWords * bestGl, int normalLen, mtf * localDictionary,
+		const CharCodec & chars, const EncodeOptions & options, string & key, GroupCandidate & group){
+	key.assign(words, length);
+	if(options.report || options.summary) cout << "CURRENT WORD : \"" << key << "\"" << endl;
+
+	if(options.report) normalCompression(key, chars, options);
+
+	// the compressed word using local dictionary
+	unsigned long long localRes;
+	int localLen;
+	float localRatio = tryLocalDict(key, normalLen, localDictionary, options, localRes, localLen);
+
+	group.words = words;
+	group.length = length;
+	group.localRes = localRes;
+	group.global = bestGl;
+
+	// the best revealed-chars combination, gotten from the global dictionary
+	float globalRatio = bestGl ? bestGl->ratio : -1;
+	if(globalRatio != -1 && globalRatio < 100 && (globalRatio < localRatio || localRatio == -1)){
+		if(options.report) cout << "Global ratio " << globalRatio << " < local ratio " << localRatio << endl;
+		group.scheme = "GLOBAL";
+		group.bits = bestGl->compressedBits.size();
+		group.ratio = globalRatio;
+	} else if (localRatio != -1 && localRatio < 100 && (globalRatio >= localRatio || globalRatio == -1)){
+		if(options.report) cout << "Global ratio " << globalRatio << " >= local ratio " << localRatio << endl;
+		group.scheme = "LOCAL";
+		group.bits = localLen;
+		group.ratio = localRatio;
+	} else {
+		// if not found in either dictionary
+		if(options.report) {
+			if(localRatio == -1 && globalRatio == -1) cout << "NOT FOUND IN EITHER DICTIONARY" << endl;
+			else cout << "NORMAL SCHEME IS BETTER: Global ratio " << globalRatio 
+				<< ", local ratio " << localRatio << " , normal: " << normalLen << endl;
+		}
+		group.scheme = "NORMAL";
+		group.bits = normalLen;
+		group.ratio = 100.0;
+	}
 
-	// compresses text, phrase by phrase	
-	while (s < bound) {
-        	//find a phrase P
-		// current position in P
-	        int t = 0;
-		// # of words in P
-        	int m = 1;
-
-		// starting indices of the words in P
-		int w [ 1 + (n - s + 1) / 2] ;	
-
-		// finds the index of the end of the phrase (either '.' or the EOF)
-		// and stores it in temp
-		int temp = s;
+	if(options.summary) {
+		CompressedWords * compressed = compressedGroup(group, chars);
+		if(group.ratio == 100) cout << "***" << endl << "COMPRESSED WORD FOR \"" << key << "\" : " 
+						<< compressed->compressedBits.text() << " (normal) 100" << endl << "***" << endl;
+		else cout << "***" << endl << "COMPRESSED WORD FOR \"" << key << "\" : " << compressed->compressedBits.text() 
+				<< " (" << (compressed->usesLocalDict ? "local" : "global") << ") " << group.ratio << endl << "***" << endl;
+		delete compressed;
+	}
+}
 
-		// finds the end of this phrase
-		while(T[temp] != '.' && temp < bound) {
-			temp++;
-		}
+// the starts of the groups of the first j words, when the last of k groups starts at from[k][j]
+vector<int> groupStarts(const SegmentArena & arena, int k, int j){
+	vector<int> result(k);
+	for(; k > 0; k--){
+		result[k-1] = arena.from[k * arena.width + j];
+		j = result[k-1];
+	}
+	return result;
+}
 
-		// stores the phrase (without '.') in P and
-		// the starting indices of the words in w
-		char P[temp - s];
-
-		while (s < temp) {
-			// first word in P starts at position 0
-			w[1] = 0; 
-
-	                P[t] = T[s];
-
-        	        if (P[t] == ' '){
-	                	m++; //counts the words
-        	        	w[m] = t + 1; // next word starts at position t+1
-		        }
-	                t++;
-        	        s++;
-		} // while
-
-
-		s++;
-
-		// best compressedPhrase for this phrase (initialized to case where numSplits = 0)
-		CompressedPhrase * best = new CompressedPhrase;
-		// current compressedPhrase for this combination of splits and revealed chars
-		CompressedPhrase * current = NULL;
-
-	 	// ************** CASE 1: numSplits = 0 
-		best->numberSplits = 0;
-		best->splits = NULL;
-                best->totalRatio = 100;
-
-                // copy of the phrase (without '.')
-                char words[t+1];
-
-                if(REPORT) cout << "ENTIRE PHRASE (numSplits = 0): " << endl; 
-                for(int q = 0; q < t; q++){
-                	words[q] = P[q];
-			if(REPORT) cout << words[q];
-                }
-                words[t] = '\0';
-                if(REPORT) cout << endl;
-
-		// the entire phrase as a string
-                string thisWord(words);
-
-		// the length of the compressed string when using the standard compression scheme
-		string normalComp = normalCompression(thisWord);
-                int normalLen = normalComp.length();
-
-		// the compressed word using local dictionary
-		CompressedWords * bestWord = tryLocalDict(thisWord,normalLen, localDictionary);
-
-                // the best revealed-chars combination, gotten from the global dictionary
-                CompressedWords * bestGl = CPlocalDictionary->findBest(thisWord, '!');
-                CompressedWords * bestGlobal;
-
-		if(bestGl == NULL){
-                        // determines the best global configuration for thisWord and stores it in the CP local dictionary
-                        bestGlobal = tryAllLetters(thisWord,normalLen, GlobalSuffixTrie,'!');
-                        bestGl = new CompressedWords(*bestGlobal);
-                        CPlocalDictionary->insert(thisWord,bestGl);
-                        if(SUMMARY) cout << "Inserted in the CP local dict: CP of \"" << thisWord << "\"" << endl;
-		} else {
-                	bestGlobal = new CompressedWords(*bestGl);
-                        if(SUMMARY) cout << "USED LOCAL SHORTCUT for \"" << thisWord << "\"" << endl;
+// splits the phrase P into groups of words, and returns the best split with the
+// compressed groups. The cost of a group only depends on its words and the last
+// letter of the group before it, so every group is costed once, in the arena,
+// and cost[k][j] (the lowest total cost of the first j words in k groups) is found
+// for all k by dynamic programming; only the groups of the best split are then
+// written. The best split has the lowest average ratio of its groups, or the
+// fewest total bits if options.segmentation is 1; on ties, the fewest groups, then
+// the first split positions (the order in which all the splits used to be enumerated),
+// compared through the order of the splits of the row before
+CompressedPhrase * segmentPhrase(const Phrase & P, SegmentArena & arena, mtf * localDictionary, const CharCodec & chars,
+		const EncodeOptions & options){
+	const string & phrase = P.text;
+	const vector<int> & starts = P.starts;
+	int m = starts.size();
+	arena.reset(m);
+	int w = arena.width;
+
+	// the bits of the chars of the phrase up to each index: a group starts the
+	// phrase or follows a space, which is the context of its first char, so the
+	// chars of a group take the difference of two of them
+	vector<unsigned int> & charBits = arena.charBits;
+	charBits.resize(phrase.length() + 1);
+	charBits[0] = 0;
+	for(unsigned int t = 0; t < phrase.length(); t++) charBits[t+1] = charBits[t] + chars.charLength(t ? phrase[t-1] : ' ', phrase[t]);
+
+	// the groups in the order of P.global
+	unsigned int g = 0;
+	for(int i = 0; i < m; i++){
+		for(int j = i + 1; j <= m; j++){
+			int end = (j == m) ? phrase.length() : starts[j] - 1;
+			int length = end - starts[i];
+			int normalLen = 3 + gammaLength(length, false) + charBits[end] - charBits[starts[i]];
+			GroupCandidate & group = arena.group(i, j);
+			const CompressedWords * bestGl = (j - i <= options.maxWords) ? P.global[g++] : NULL;
+			compressGroup(phrase.data() + starts[i], length, bestGl, normalLen, localDictionary, chars, options, arena.key, group);
+			arena.groupCost[j * w + i] = (options.segmentation == 1) ? group.bits : group.ratio;
 		}
+	}
 
-
-		// stores the better of bestGlobal and bestWord in bestWord, deletes the other
-		if(bestGlobal->ratio != -1 && bestGlobal->ratio < 100 && (bestGlobal->ratio < bestWord->ratio || bestWord->ratio == -1)){
-			if(REPORT) cout << "Global ratio " << bestGlobal->ratio << " < local ratio " << bestWord->ratio << endl;
-			delete bestWord;
-			bestWord = bestGlobal;
-			bestWord->encodingScheme = "GLOBAL";
-		} else if (bestWord->ratio != -1 && bestWord->ratio < 100 && (bestGlobal->ratio >= bestWord->ratio || bestGlobal->ratio == -1)){
-			if(REPORT) cout << "Global ratio " << bestGlobal->ratio << " >= local ratio " << bestWord->ratio << endl;
-			delete bestGlobal;
-                        bestWord->encodingScheme = "LOCAL";
-		} else {
-			// if not found in either dictionary
-			delete bestGlobal;
-			if(REPORT) {
-				if(bestWord->ratio == -1 && bestGlobal->ratio == -1) cout << "NOT FOUND IN EITHER DICTIONARY" << endl;
-				else cout << "NORMAL SCHEME IS BETTER: Global ratio " << bestGlobal->ratio 
-					<< ", local ratio " << bestWord->ratio << " , normal: " << normalLen << endl;
+	// sums the costs in the same order as a whole split would, so the totals are the same
+	vector<float> & cost = arena.cost;
+	vector<int> & from = arena.from;
+	vector<int> & order = arena.order;
+	from[0] = 0;
+	int bestK = 0;
+	float bestCost = 0;
+	for(int k = 1; k <= m; k++){
+		for(int j = k; j <= m; j++){
+			for(int i = k - 1; i < j; i++){
+				if(from[(k-1) * w + i] == -1) continue;
+				float c = cost[(k-1) * w + i] + arena.groupCost[j * w + i];
+				int f = from[k * w + j];
+				bool better = f == -1 || c < cost[k * w + j];
+				// groupStarts(k - 1, i) + i against groupStarts(k - 1, f) + f
+				if(!better && c == cost[k * w + j])
+					better = make_pair(order[(k-1) * w + i], i) < make_pair(order[(k-1) * w + f], f);
+				if(better){
+					cost[k * w + j] = c;
+					from[k * w + j] = i;
+				}
 			}
-			bestWord->ratio = 100.0;
-			bestWord->compressedString = normalComp;
-                        bestWord->encodingScheme = "NORMAL";
 		}
 
-                best->WordsSet.push_back(bestWord);
-                best->totalRatio = bestWord->ratio;
-
-		if(SUMMARY && bestWord->ratio == 100) cout << "***" << endl << "COMPRESSED WORD FOR \"" 
-							<< thisWord << "\" : " << bestWord->compressedString << " (normal) 100" << endl << "***" << endl;
-		else if(SUMMARY) cout << "***" << endl << "COMPRESSED WORD FOR \"" << thisWord << "\" : " << bestWord->compressedString << " (" 
-				<< (bestWord->usesLocalDict ? "local" : "global") << ") " << bestWord->ratio << endl << "***" << endl;
+		// orders the splits of row k, for the ties of row k + 1
+		arena.row.clear();
+		for(int j = k; j <= m; j++){
+			int f = from[k * w + j];
+			if(f != -1) arena.row.push_back(make_pair(make_pair(order[(k-1) * w + f], f), j));
+		}
+		sort(arena.row.begin(), arena.row.end());
+		for(unsigned int r = 0, position = 0; r < arena.row.size(); r++){
+			if(r > 0 && arena.row[r].first != arena.row[r-1].first) position++;
+			order[k * w + arena.row[r].second] = position;
+		}
 
+		// the objective for k groups (the bits include the number of groups)
+		float objective = (options.segmentation == 1) ? cost[k * w + m] + gammaLength(k) : cost[k * w + m] / k;
+		if(bestK == 0 || objective < bestCost){
+			bestK = k;
+			bestCost = objective;
+		}
+	}
 
-		// ************** CASE 2: 1 <= numSplits <= m-1
-		// tries to split the phrase p in all possible ways
-		for(int numSplits = 1; numSplits <= m - 1; numSplits++){
-			if(REPORT || SUMMARY) cout << "NUMSPLITS: " << numSplits << endl;
+	// the best split, with its groups written out
+	CompressedPhrase * best = new CompressedPhrase;
+	vector<int> first = groupStarts(arena, bestK, m);
+	best->numberSplits = bestK - 1;
+	best->splits = new int[bestK];
+	best->totalRatio = 0;
+	for(int k = 0; k < bestK; k++){
+		int next = (k + 1 < bestK) ? first[k+1] : m;
+		CompressedWords * group = compressedGroup(arena.group(first[k], next), chars);
+		best->WordsSet.push_back(group);
+		best->totalRatio += group->ratio;
+		if(k > 0) best->splits[k-1] = starts[first[k]] - 1;
+	}
+	return best;
+}
 
-			// creates a list of all possible combinations of numSplits chosen from the m-1 splits
-			findAllCombinations(m - 1, numSplits);
 
-			// the indices of the current splits
-			int splits[numSplits];
+// writes the fields of a compressed group of words to out, as decodePhrase
+// (decode.cc) reads them
+void writeGroup(FieldWriter & out, const CompressedWords & group){
+	const string & words = group.words;
+	if(group.encodingScheme[0] == 'L') {
+		out.scheme(SCHEME_LOCAL);
+		out.number(FIELD_LOCAL, group.index + 1);
+	} else if(group.encodingScheme[0] == 'N') {
+		out.scheme(SCHEME_NORMAL);
+		out.number(FIELD_LENGTH, words.length());
+		out.literals(words);
+	} else {
+		// the revealed chars, each after its position difference, then the
+		// difference to the end and the rank
+		out.scheme(SCHEME_GLOBAL);
+		out.number(FIELD_REVEALS, group.revealedChars.size());
+		int prev = 0;
+		for(vector<int>::const_iterator IT = group.revealedChars.begin(); IT != group.revealedChars.end(); IT++){
+			out.number(FIELD_POSITION, (*IT) - prev + 1);
+			out.revealed(words[*IT]);
+			prev = (*IT) + 1;
+		}
+		out.number(FIELD_END, words.length() - prev + 1);
+		out.number(FIELD_RANK, group.index + 1);
+	}
+}
 
-			// tries every combination of numSplits splits
-			for(vector< vector<int> >::iterator it = combinationList.begin(); it != combinationList.end(); it++){
-				if(REPORT) cout << "  ";
 
-				// current split index
-				int j = 0;
-				// stores the indices of the splits
-				for(vector<int>::iterator iter = (*it).begin(); iter!=(*it).end(); iter++){
-					if(REPORT) cout << (*iter) << " , ";
-					splits[j] = w[(*iter) + 1] - 1;
-					j++;
-				}
-				if(REPORT) cout << endl;
+// writes the fields of the best compression of text to out
+void compressFields(string text, trie * GlobalSuffixTrie, const EncodeOptions & options, FieldWriter & out){
 
-				// compressed phrase for this combination
-				current = new CompressedPhrase;
+	Statistics stats;
 
-				current->splits = new int[numSplits];
-				current->totalRatio = 0;
+	mtf * localDictionary = new mtf;
 
-				// stores number of splits + positions of splits in current
-				current->numberSplits = numSplits;
-				for(int l = 0; l < numSplits; l++){
-					(current->splits)[l] = splits[l];
-				}
+	// the char codes of the scheme of the options, for the whole text
+	const CharCodec chars(options.encodingChars, options.huffman);
+
+	// simplifies text and removes extra spaces, in one pass: the numbers of
+	// spaces, then the case bits with RLE
+	NormalizedText normalized;
+	normalizeText(text, normalized);
+	if(options.report) {
+		cout << "SIMPLIFIED \"" << text << "\" to \"" << normalized.text << "\" with spaces";
+		for(unsigned int i = 0; i < normalized.spaces.size(); i++) cout << " " << normalized.spaces[i];
+		cout << " and RLE bit vector " << normalized.caseFirst << ":";
+		for(unsigned int i = 0; i < normalized.caseRuns.size(); i++) cout << " " << normalized.caseRuns[i];
+		cout << endl;
+	}
+	text.swap(normalized.text);
 
-				char lastLetter = '!';
-
-				// tries to compress each set of words
-				for(int k = 0; k <= numSplits; k++){
-					// length of current group of words
-					int len;
-					if(k == 0) len = splits[0];
-					else if(k == numSplits) len = t - splits[numSplits-1] - 1;
-					else len = splits[k] - splits[k-1] - 1;
-
-					// current set of words
-					char words[len+1];
-
-					// prints current words
-					if(REPORT || SUMMARY) cout << "CURRENT WORD # " << k << " (of " << numSplits << ") : \"";
-
-					// stores current set of words in words
-					for(int q = 0; q < len; q++){
-						if(k == 0) words [q] = P[q];
-						else if(k == numSplits) words[q] = P[q + splits[numSplits-1] + 1];
-						else words[q] = P[splits[k-1]+1+q];
-						if(REPORT || SUMMARY) cout << words[q];
-					}
-					words[len] = '\0';
-					if(REPORT || SUMMARY) cout << "\"" << endl;
-
-	                                string thisWord(words);
-
-			                // the compressed string and its length when using the standard compression scheme
-			                string normalComp = normalCompression(thisWord);
-			                int normalLen = normalComp.length();
-
-			                // the compressed word using local dictionary
-			                CompressedWords * bestWord = tryLocalDict(thisWord,normalLen, localDictionary);
-
-			                // the best revealed-chars combination, gotten from the global dictionary
-			                // the best revealed-chars combination, gotten from the global dictionary
-			                CompressedWords * bestGl = CPlocalDictionary->findBest(thisWord,lastLetter);
-			                CompressedWords * bestGlobal;
-
-			                if(bestGl == NULL){
-                        			// determines the best global configuration for thisWord and stores it in the CP local dictionary
-			                        bestGlobal = tryAllLetters(thisWord,normalLen, GlobalSuffixTrie,lastLetter);
-                        			bestGl = new CompressedWords(*bestGlobal);
-			                        CPlocalDictionary->insert(thisWord,bestGl);
-                        			if(SUMMARY) cout << "Inserted in the CP local dict: CP of \"" << thisWord << "\"" << endl;
-			                } else {
-                        			bestGlobal = new CompressedWords(*bestGl);
-			                        if(SUMMARY) cout << "USED LOCAL SHORTCUT for \"" << thisWord << "\"" << endl;
-                			}
-
-
-
-			                // stores the better of bestGlobal and bestWord in bestWord, deletes the other
-			                if(bestGlobal->ratio != -1 && bestGlobal->ratio < 100 && (bestGlobal->ratio < bestWord->ratio || bestWord->ratio == -1)){
-			                        if(REPORT) cout << "Global ratio " << bestGlobal->ratio << " < local ratio " << bestWord->ratio << endl;
-			                        delete bestWord;
-                        			bestWord = bestGlobal;
-						bestWord->encodingScheme = "GLOBAL";
-			                } else if (bestWord->ratio != -1 && bestWord->ratio < 100 && (bestGlobal->ratio >= bestWord->ratio || bestGlobal->ratio == -1)){
-                        			if(REPORT) cout << "Global ratio " << bestGlobal->ratio << " >= local ratio " << bestWord->ratio << endl;
-			                        delete bestGlobal;
-                                                bestWord->encodingScheme = "LOCAL";
-			                } else {
-                        			// if not found in either dictionary
-			                        delete bestGlobal;
-                        			if(REPORT) {
-			                                if(bestWord->ratio == -1 && bestGlobal->ratio == -1) cout << "NOT FOUND IN EITHER DICTIONARY" << endl;
-                        			        else cout << "NORMAL SCHEME IS BETTER: Global ratio " << bestGlobal->ratio 
-								<< ", local ratio " << bestWord->ratio << " , normal: " << normalLen << endl;
-                        			}
-                        			bestWord->ratio = 100.0;
-                        			bestWord->compressedString = normalComp;
-                                                bestWord->encodingScheme = "NORMAL";
-                			}
-					// adds bestWord to current
-	                                current->WordsSet.push_back(bestWord);
-	                                current->totalRatio += bestWord->ratio;
-	
-        			        if(SUMMARY && bestWord->ratio == 100) cout << "***" << endl << "COMPRESSED WORD FOR \"" << thisWord << "\" : " 
-										<< bestWord->compressedString << " (normal) 100" << endl << "***" << endl;
-                			else if(SUMMARY) cout << "***" << endl << "COMPRESSED WORD FOR \"" << thisWord << "\" : " << bestWord->compressedString 
-							<< " (" << (bestWord->usesLocalDict ? "local" : "global") << ") " << bestWord->ratio << endl << "***" << endl;
-
-					lastLetter = words[len-1];
-cout << "LAST LETTER before this word (" << thisWord << ") : " << lastLetter << endl;
-				} // for
-				if(REPORT) cout << "TOTAL RATIO for these splits: " << current->totalRatio << " ; best TOTAL : " << best->totalRatio << endl;
-                                if(REPORT) cout << "AVG RATIO for these splits: " << current->totalRatio / (1 + current->numberSplits) << " ; best AVG : " 
-					<< best->totalRatio / (1 + best->numberSplits) << endl;
-
-				// if current has better ratio than best, stores current in best; else deletes current
-				if(current->totalRatio  / (1+current->numberSplits) < best->totalRatio / (1 + best->numberSplits)) {
-					delete best;
-					best = current;
-					current = NULL;
-					if(REPORT) cout << "BEST REPLACED BY CURRENT" << endl;
-				} else {
-					delete current;
-					current = NULL;
-				}
+	int n = text.length();
 
-			} // for
+	// the last index in text that holds a letter (not '.')
+	int bound;
 
-			combinationList.clear();
-		} // for
+	// indicates whether text ends with '.' ("1") or not ("0")
+	bool dot;
+	if(n > 0 && text[n-1] == '.') {
+		bound = n - 1;
+		dot = true;
+	} else {
+		bound = n;
+		dot = false;
+	}
 
+	// the dot indicator comes first
+	out.flag(FIELD_DOT, dot);
+
+	vector<Phrase> phrases = splitPhrases(text, bound);
+
+	// the global dictionary work, for all the phrases at once
+	GlobalCandidates candidates;
+	findGlobalCandidates(phrases, GlobalSuffixTrie, chars, candidates, options);
+
+	// compresses text, phrase by phrase, using and updating the local dictionary
+	SegmentArena arena;
+	vector<CompressedPhrase *> parts;
+	for(vector<Phrase>::iterator P = phrases.begin(); P != phrases.end(); P++){
+		// best compressedPhrase for this part of the phrase; the phrase is only
+		// written (and put in the local dictionary) once all its parts are
+		CompressedPhrase * part = segmentPhrase(*P, arena, localDictionary, chars, options);
+		stats.numWordGroups[1 + part->numberSplits]++;
+		parts.push_back(part);
+		if(P->more) continue;
+
+		// the groups of the parts, and their ratios
+		vector<CompressedWords *> groups;
+		float totalRatio = 0;
+		for(vector<CompressedPhrase *>::iterator IT = parts.begin(); IT != parts.end(); IT++){
+			groups.insert(groups.end(), (*IT)->WordsSet.begin(), (*IT)->WordsSet.end());
+			totalRatio += (*IT)->totalRatio;
+		}
+		int numberSplits = groups.size() - 1;
 
 		// updates statistics + local dictionary
-		numWordGroups[1 + best->numberSplits]++;
-		for(vector<CompressedWords *>::iterator ITERAT = best->WordsSet.begin(); ITERAT != best->WordsSet.end(); ITERAT++){
+		for(vector<CompressedWords *>::iterator ITERAT = groups.begin(); ITERAT != groups.end(); ITERAT++){
 			// updates # letters
-			numberLetters[(*ITERAT)->numLetters]++;
+			stats.numberLetters[(*ITERAT)->numLetters]++;
 
 			// words encoded
 			string tmp = (*ITERAT)->words;
 
 			// updates encoding schemes
 			string scheme = (*ITERAT)->encodingScheme;
-			if(scheme == "NORMAL") schemes[0]++;
-			else if(scheme == "LOCAL") schemes[1]++;
-			else schemes[2]++;
+			if(scheme == "NORMAL") stats.schemes[0]++;
+			else if(scheme == "LOCAL") stats.schemes[1]++;
+			else stats.schemes[2]++;
 
 			// updates local dictionary
 			localDictionary->insert(tmp,NULL);
-			if(REPORT || SUMMARY) cout << "local: inserting \"" << tmp << "\" (" << scheme << " used) with compressed word" << endl;
+			if(options.report || options.summary) cout << "local: inserting \"" << tmp << "\" (" << scheme << " used) with compressed word" << endl;
 
 			// updates words in word group
 			istringstream tempIn (tmp.c_str());
@@ -809,51 +815,65 @@ cout << "LAST LETTER before this word (" << thisWord << ") : " << lastLetter <<
 			while(tempIn >> tm) {
 				l++;
 				if(tmp != tm){
-					if(REPORT || SUMMARY) cout << "local: inserting \"" << tm << "\"" << endl;
+					if(options.report || options.summary) cout << "local: inserting \"" << tm << "\"" << endl;
 					localDictionary->insert(tm,NULL);
 				}
 			}
-			numWordsInGroup[l]++;
+			stats.numWordsInGroup[l]++;
 		}
 
 		/// ******************* APPEND COMPRESSED PHRASE TO RESULT *********
 		// adds # of word groups in this phrase
-		finalRes = finalRes + convertToBinary(best->numberSplits + 1); 
+		out.flag(FIELD_PHRASE, true);
+		out.number(FIELD_GROUPS, numberSplits + 1);
 
 
-                if(SUMMARY || REPORT) cout << "THE BEST FOR THIS PHRASE: avgRatio = " << best->totalRatio / (1 + best->numberSplits) << " (total "
-                                        << best->totalRatio << " / (1 + numSplits " << best->numberSplits << ")) " << endl;
+                if(options.summary || options.report) cout << "THE BEST FOR THIS PHRASE: avgRatio = " << totalRatio / (1 + numberSplits) << " (total "
+                                        << totalRatio << " / (1 + numSplits " << numberSplits << ")) " << endl;
 
-                if(SUMMARY || END) cout << "CONFIG : \"";
+                if(options.summary || options.end) cout << "CONFIG : \"";
 
 
 		// adds each compressed string for the groups of words 
-		for (vector<CompressedWords *>::iterator ITERAT = best->WordsSet.begin(); ITERAT != best->WordsSet.end(); ITERAT++){
-			finalRes = finalRes + (*ITERAT)->compressedString;
-			if(SUMMARY || END) cout << (*ITERAT)->words << "|" ;
+		for (vector<CompressedWords *>::iterator ITERAT = groups.begin(); ITERAT != groups.end(); ITERAT++){
+			writeGroup(out, **ITERAT);
+			if(options.summary || options.end) cout << (*ITERAT)->words << "|" ;
 		}
-		if(SUMMARY || END) cout << "\"" << endl;
-
-		delete best;
-
+		if(options.summary || options.end) cout << "\"" << endl;
 
-		combinationList.clear();
-		combinationLetters.clear();
-
-	} // while
+		for(vector<CompressedPhrase *>::iterator IT = parts.begin(); IT != parts.end(); IT++) delete *IT;
+		parts.clear();
+	} // for
 
 	delete localDictionary;
-	delete CPlocalDictionary;
+	for(GlobalCandidates::iterator it = candidates.begin(); it != candidates.end(); it++) delete it->second;
 
 	// prints statistics
-	if(STATS) printStats();
-	// adds dot indicator, and "10" (indicates end of phrases) + bitVector
-	string endResult = dot + finalRes + "10" + bitVector;
+	if(options.stats) printStats(stats);
+	// the end of the phrases, then the numbers of spaces and the runs of the
+	// case bits, with the bits the gamma format gives them
+	out.flag(FIELD_PHRASE, false);
+	unsigned long long vectorBits = 1;
+	for(vector<unsigned long long>::iterator it = normalized.spaces.begin(); it != normalized.spaces.end(); it++) {
+		out.number(FIELD_SPACES, *it);
+		vectorBits += gammaLength(*it, false);
+	}
+	out.flag(FIELD_RLE_FIRST, normalized.caseFirst);
+	for(vector<unsigned long long>::iterator it = normalized.caseRuns.begin(); it != normalized.caseRuns.end(); it++) {
+		out.flag(FIELD_RLE_MORE, true);
+		out.number(FIELD_RLE_RUN, *it);
+		vectorBits += gammaLength(*it, false);
+	}
+	out.flag(FIELD_RLE_MORE, false);
 
 	// outputs final ratio
-        if(SUMMARY || STATS || END) cout << "FINAL Ratio : " << 100.0 * endResult.length() / (1 + bitVector.length()+ 14 * text.length()) << endl;
-
-	return endResult;
+        if(options.summary || options.stats || options.end) cout << "FINAL Ratio : " << 100.0 * out.bits() / (1 + vectorBits + 14 * text.length()) << endl;
 }
 
-
+// returns the bits of the best compression of text
+BitWriter bestCompression (string text, trie * GlobalSuffixTrie, const EncodeOptions & options){
+	BitWriter bits;
+	GammaFieldWriter out(bits, CharCodec(options.encodingChars, options.huffman));
+	compressFields(text, GlobalSuffixTrie, options, out);
+	return bits;
+}
@@ -3,9 +3,48 @@
 #include <string>
 #include "suffix_trie.h"
 #include "wordclass.h"
+#include "chars.h"
 
-std::string bestCompression (std::string text, trie * GlobalSuffixTrie);
+// the most words of a phrase segmented at once: a longer phrase (as in a text
+// without periods) is segmented in parts of that many words
+#define PHRASE_MAX_WORDS 128
 
-CompressedWords * tryAllLetters(std::string text, int normalLen, trie * GlobalSuffixTrie);
+class GlobalCache;
+class FieldWriter;
+
+// the options of one compression: bestCompression only reads its own copy, so
+// compressions with other options can run at once. By default the chars are in
+// scheme 0, without a cache, and nothing is printed
+struct EncodeOptions {
+	// the chars scheme (0 normal, 1 frequencies of letters, 2 Huffman codes),
+	// and the Huffman codes of scheme 2
+	int encodingChars;
+	const HuffmanChars * huffman;
+	// segmentation of the phrases: 0 = lowest average ratio of the word groups,
+	// 1 = fewest total bits
+	int segmentation;
+	// the most words in a group, and chars revealed in a group, that the global
+	// dictionary is tried with
+	int maxWords;
+	int maxRevealedChars;
+	// the levels of output comments: very detailed, some details, few details,
+	// and statistics about optimum wordgroup/guess combinations
+	bool report;
+	bool summary;
+	bool end;
+	bool stats;
+	// the cache of global compressions (NULL: none)
+	GlobalCache * cache;
+	EncodeOptions();
+};
+
+// writes the fields of the best compression of text to out (see fields.h)
+void compressFields(std::string text, trie * GlobalSuffixTrie, const EncodeOptions & options, FieldWriter & out);
+
+// the bits of the gamma format of the best compression of text
+BitWriter bestCompression (std::string text, trie * GlobalSuffixTrie, const EncodeOptions & options = EncodeOptions());
+
+CompressedWords * tryAllLetters(std::string text, int normalLen, trie * GlobalSuffixTrie, char lastLetter, const CharCodec & chars,
+	const EncodeOptions & options);
 
 #endif
@@ -0,0 +1,129 @@
+#include "fields.h"
+
+using namespace std;
+
+bool GammaFieldReader::flag(Field field) {
+	if(field == FIELD_PHRASE) {
+		if(in.eof()) return false;
+		if(in.peek(2) == 2) {
+			in.read(2);
+			return false;
+		}
+		return true;
+	}
+	if(field == FIELD_RLE_MORE) return !in.eof();
+	return in.readBit();
+}
+
+// the counts and the local index are written with the extra 1
+static inline bool gammaAddOne(Field field) {
+	return field == FIELD_GROUPS || field == FIELD_REVEALS || field == FIELD_LOCAL;
+}
+
+unsigned long long GammaFieldReader::number(Field field) {
+	return readGamma(in, gammaAddOne(field));
+}
+
+GroupScheme GammaFieldReader::scheme() {
+	// "0" is global; "110" is normal, and a local index never starts with "10"
+	if(!in.readBit()) return SCHEME_GLOBAL;
+	if(in.peek(2) == 2) {
+		in.read(2);
+		return SCHEME_NORMAL;
+	}
+	return SCHEME_LOCAL;
+}
+
+void GammaFieldWriter::flag(Field field, bool value) {
+	// the phrases end with "10", and the runs with the bits
+	if(field == FIELD_PHRASE) {
+		if(!value) out.write(2, 2);
+		return;
+	}
+	if(field == FIELD_RLE_MORE) return;
+	out.writeBit(value);
+}
+
+void GammaFieldWriter::number(Field field, unsigned long long n) {
+	writeGamma(out, n, gammaAddOne(field));
+}
+
+void GammaFieldWriter::scheme(GroupScheme s) {
+	if(s == SCHEME_NORMAL) out.write(6, 3);
+	else out.writeBit(s == SCHEME_LOCAL);
+}
+
+
+unsigned long long RangeFieldReader::number(Field field) {
+	unsigned int len = 1;
+	while(len < RANGE_NUMBER_BITS - 1 && !decoder.decode(models.length(field, len - 1))) len++;
+	unsigned long long n = 1;
+	for(unsigned int i = 1; i < len; i++) n = (n << 1) | decoder.decode(models.mantissa(field, len, i));
+	return n;
+}
+
+GroupScheme RangeFieldReader::scheme() {
+	if(!decoder.decode(models.scheme(0))) return SCHEME_GLOBAL;
+	return decoder.decode(models.scheme(1)) ? SCHEME_NORMAL : SCHEME_LOCAL;
+}
+
+char RangeFieldReader::symbol(unsigned int context) {
+	unsigned int node = 1;
+	while(node < (1u << RANGE_SYMBOL_BITS)) node = (node << 1) | decoder.decode(models.symbol(context, node));
+	unsigned int s = node - (1 << RANGE_SYMBOL_BITS);
+	if(s) return huffman_char(s);
+
+	node = 1;
+	while(node < 256) node = (node << 1) | decoder.decode(models.escape(node));
+	return (char) (node - 256);
+}
+
+string RangeFieldReader::literals(unsigned int len) {
+	string result;
+	result.reserve(len);
+	char prev = ' ';
+	for(unsigned int i = 0; i < len; i++) {
+		prev = symbol(FieldModels::literalContext(prev));
+		result += prev;
+	}
+	return result;
+}
+
+
+void RangeFieldWriter::number(Field field, unsigned long long n) {
+	unsigned int len = bitLength(n);
+	for(unsigned int i = 1; i < len; i++) encoder.encode(models.length(field, i - 1), 0);
+	if(len < RANGE_NUMBER_BITS - 1) encoder.encode(models.length(field, len - 1), 1);
+	for(unsigned int i = 1; i < len; i++) encoder.encode(models.mantissa(field, len, i), n >> (len - 1 - i) & 1);
+}
+
+void RangeFieldWriter::scheme(GroupScheme s) {
+	encoder.encode(models.scheme(0), s != SCHEME_GLOBAL);
+	if(s != SCHEME_GLOBAL) encoder.encode(models.scheme(1), s == SCHEME_NORMAL);
+}
+
+void RangeFieldWriter::symbol(unsigned int context, char c) {
+	unsigned int s = huffman_symbol(c);
+	unsigned int node = 1;
+	for(int i = RANGE_SYMBOL_BITS - 1; i >= 0; i--) {
+		bool bit = s >> i & 1;
+		encoder.encode(models.symbol(context, node), bit);
+		node = (node << 1) | bit;
+	}
+	if(s) return;
+
+	node = 1;
+	for(int i = 7; i >= 0; i--) {
+		bool bit = (unsigned char) c >> i & 1;
+		encoder.encode(models.escape(node), bit);
+		node = (node << 1) | bit;
+	}
+}
+
+void RangeFieldWriter::literals(const string & text) {
+	char prev = ' ';
+	for(unsigned int i = 0; i < text.length(); i++) {
+		symbol(FieldModels::literalContext(prev), text[i]);
+		prev = text[i];
+	}
+}
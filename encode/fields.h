@@ -0,0 +1,189 @@
+#ifndef __FIELDS_H__
+#define __FIELDS_H__
+#include <string>
+#include <vector>
+#include "bitstream.h"
+#include "chars.h"
+#include "rangecoder.h"
+
+// the fields of the compressed format, in the order decodeText reads them:
+//   DOT                      the text ends with '.'
+//   PHRASE                   another phrase follows
+//   GROUPS                   the number of word groups of a phrase
+//   SCHEME                   global, local or normal, for each group
+//   REVEALS, POSITION, REVEALED, END, RANK   a global group
+//   LOCAL                    a local group (its index + 1)
+//   LENGTH, LITERALS         a normal group
+//   SPACES                   the number of spaces + 1 around the words
+//   RLE_FIRST, RLE_MORE, RLE_RUN   the case and comma bits, run-length coded
+// The numbers are at least 1. The encoder writes the fields to a FieldWriter
+// of either format. In the gamma format, the flags and schemes are bits, the
+// numbers gamma codes, and the chars are coded by a CharCodec; the range format
+// codes each field with its own adaptive models instead.
+enum Field {
+	FIELD_DOT, FIELD_PHRASE, FIELD_GROUPS, FIELD_SCHEME, FIELD_REVEALS, FIELD_POSITION,
+	FIELD_REVEALED, FIELD_END, FIELD_RANK, FIELD_LOCAL, FIELD_LENGTH, FIELD_LITERALS,
+	FIELD_SPACES, FIELD_RLE_FIRST, FIELD_RLE_MORE, FIELD_RLE_RUN, NUM_FIELDS
+};
+
+enum GroupScheme { SCHEME_GLOBAL, SCHEME_LOCAL, SCHEME_NORMAL };
+
+// where the decoder reads the fields from. A broken input can claim any number:
+// the decoder checks them with left(), and fails the reader when one is more
+// than the input (or the text) can hold, then stops
+class FieldReader {
+  private:
+	bool broken;
+
+  public:
+	FieldReader(): broken(false) {}
+	virtual ~FieldReader() {}
+	virtual bool flag(Field field) = 0;
+	virtual unsigned long long number(Field field) = 0;
+	virtual GroupScheme scheme() = 0;
+	// the chars of a normal group, and a revealed char
+	virtual std::string literals(unsigned int len) = 0;
+	virtual char revealed() = 0;
+	// the most chars (literals, or revealed chars) the rest of the input can code
+	virtual unsigned long long left() const = 0;
+	void fail() { broken = true; }
+	bool failed() const { return broken; }
+};
+
+// where the encoder writes the fields to, in the same order
+class FieldWriter {
+  public:
+	virtual ~FieldWriter() {}
+	virtual void flag(Field field, bool value) = 0;
+	virtual void number(Field field, unsigned long long n) = 0;
+	virtual void scheme(GroupScheme s) = 0;
+	virtual void literals(const std::string & text) = 0;
+	virtual void revealed(char c) = 0;
+	// the bits written so far (for the output comments)
+	virtual unsigned long long bits() const = 0;
+};
+
+// the gamma format. PHRASE is false at the "10" that ends the phrases (or at
+// the end), and RLE_MORE at the end of the bits
+class GammaFieldReader: public FieldReader {
+  private:
+	BitReader & in;
+	CharCodec chars;
+
+  public:
+	GammaFieldReader(BitReader & in, const CharCodec & chars): in(in), chars(chars) {}
+	bool flag(Field field);
+	unsigned long long number(Field field);
+	GroupScheme scheme();
+	std::string literals(unsigned int len) { return chars.readChars(in, len); }
+	char revealed() { return chars.readChar(in); }
+	// a char takes at least a bit
+	unsigned long long left() const { return in.left(); }
+};
+
+class GammaFieldWriter: public FieldWriter {
+  private:
+	BitWriter & out;
+	CharCodec chars;
+
+  public:
+	GammaFieldWriter(BitWriter & out, const CharCodec & chars): out(out), chars(chars) {}
+	void flag(Field field, bool value);
+	void number(Field field, unsigned long long n);
+	void scheme(GroupScheme s);
+	void literals(const std::string & text) { chars.writeChars(out, text); }
+	void revealed(char c) { chars.writeChar(out, c); }
+	unsigned long long bits() const { return out.size(); }
+};
+
+// the probabilities of the range format. A number of len bits is coded as
+// len - 1 zeros and a 1, each in the context of its position, then its bits
+// after the first, each in the context of len and its position; a char is
+// coded as its huffman_symbol, 5 bits down a binary tree in the context of the
+// char before it (literals) or none (revealed chars), and the chars without a
+// symbol as 8 more bits after symbol 0
+#define RANGE_NUMBER_BITS 65
+#define RANGE_CHAR_CONTEXTS (1 + HUFFMAN_SYMBOLS)
+#define RANGE_SYMBOL_BITS 5
+
+// the most chars a byte of the range format codes: a probability stops moving
+// 31 / 2048 from either end, so a bit takes at least log2(2048 / 2017), over
+// 1 / 46 of a bit, and a char RANGE_SYMBOL_BITS of them, over 1 / 10 of a bit
+#define RANGE_MAX_CHARS_PER_BYTE 80
+
+class FieldModels {
+  private:
+	// where each kind of model starts in probs
+	enum {
+		SCHEMES = NUM_FIELDS,
+		LENGTHS = SCHEMES + 3,
+		MANTISSAS = LENGTHS + NUM_FIELDS * RANGE_NUMBER_BITS,
+		SYMBOLS = MANTISSAS + NUM_FIELDS * RANGE_NUMBER_BITS * 64,
+		ESCAPES = SYMBOLS + RANGE_CHAR_CONTEXTS * (1 << RANGE_SYMBOL_BITS),
+		NUM_MODELS = ESCAPES + 256
+	};
+	std::vector<RangeProb> probs;
+
+  public:
+	FieldModels(): probs(NUM_MODELS, RANGE_PROB_INIT) {}
+	RangeProb & flag(Field field) { return probs[field]; }
+	// node 0 tells global from the others, node 1 local from normal
+	RangeProb & scheme(unsigned int node) { return probs[SCHEMES + node]; }
+	RangeProb & length(Field field, unsigned int i) { return probs[LENGTHS + field * RANGE_NUMBER_BITS + i]; }
+	RangeProb & mantissa(Field field, unsigned int len, unsigned int i) { return probs[MANTISSAS + (field * RANGE_NUMBER_BITS + len) * 64 + i]; }
+	RangeProb & symbol(unsigned int context, unsigned int node) { return probs[SYMBOLS + (context << RANGE_SYMBOL_BITS) + node]; }
+	RangeProb & escape(unsigned int node) { return probs[ESCAPES + node]; }
+	// the context of a literal after prev (0 is for the revealed chars)
+	static unsigned int literalContext(char prev) { return 1 + huffman_symbol(prev); }
+};
+
+class RangeFieldReader: public FieldReader {
+  private:
+	RangeDecoder decoder;
+	FieldModels models;
+	char symbol(unsigned int context);
+
+  public:
+	RangeFieldReader(const unsigned char * data, unsigned long long size): decoder(data, size) {}
+	bool flag(Field field) { return decoder.decode(models.flag(field)); }
+	unsigned long long number(Field field);
+	GroupScheme scheme();
+	std::string literals(unsigned int len);
+	char revealed() { return symbol(0); }
+	// (with the bytes the decoder has read ahead)
+	unsigned long long left() const { return RANGE_MAX_CHARS_PER_BYTE * (decoder.left() + 5); }
+};
+
+class RangeFieldWriter: public FieldWriter {
+  private:
+	RangeEncoder encoder;
+	FieldModels models;
+	void symbol(unsigned int context, char c);
+
+  public:
+	void flag(Field field, bool value) { encoder.encode(models.flag(field), value); }
+	void number(Field field, unsigned long long n);
+	void scheme(GroupScheme s);
+	void literals(const std::string & text);
+	void revealed(char c) { symbol(0, c); }
+	unsigned long long bits() const { return 8 * encoder.size(); }
+	const std::string & finish() { return encoder.finish(); }
+};
+
+// writes the fields to two writers at once (e.g. both formats)
+class FieldTee: public FieldWriter {
+  private:
+	FieldWriter & first;
+	FieldWriter & second;
+
+  public:
+	FieldTee(FieldWriter & first, FieldWriter & second): first(first), second(second) {}
+	void flag(Field field, bool value) { first.flag(field, value); second.flag(field, value); }
+	void number(Field field, unsigned long long n) { first.number(field, n); second.number(field, n); }
+	void scheme(GroupScheme s) { first.scheme(s); second.scheme(s); }
+	void literals(const std::string & text) { first.literals(text); second.literals(text); }
+	void revealed(char c) { first.revealed(c); second.revealed(c); }
+	unsigned long long bits() const { return first.bits(); }
+};
+
+#endif
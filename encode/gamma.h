@@ -0,0 +1,115 @@
+#ifndef __GAMMA_H__
+#define __GAMMA_H__
+#include "bitstream.h"
+
+// Elias-gamma codes of the codec. A number n of len bits is written as len - 1
+// zeros, then (if addOne) a 1, then n in binary (which starts with a 1):
+//   addOne:     zeros(len - 1) + "1" + binary(n)   e.g. 5 -> 001101
+//   not addOne: zeros(len - 1) + binary(n)         e.g. 5 -> 00101
+
+// the number of bits of n in binary (0 for 0)
+inline unsigned int bitLength(unsigned long long n) {
+	return n ? 64 - __builtin_clzll(n) : 0;
+}
+
+// the number of bits of the code of n
+inline unsigned int gammaLength(unsigned long long n, bool addOne = true) {
+	unsigned int len = bitLength(n);
+	return (len ? 2 * len - 1 : 0) + addOne;
+}
+
+inline void writeGamma(BitWriter & out, unsigned long long n, bool addOne = true) {
+	unsigned int len = bitLength(n);
+	// the leading zeros come for free when the whole code fits in one write
+	if(len <= 32) {
+		out.write(addOne ? n | 1ULL << len : n, gammaLength(n, addOne));
+		return;
+	}
+	out.writeZeros(len - 1);
+	if(addOne) out.writeBit(1);
+	out.write(n, len);
+}
+
+// reads the next code from in, one field at a time
+inline unsigned long long readGammaSlow(BitReader & in, bool addOne) {
+	unsigned int len = in.readZeros() + 1;
+	if(addOne) in.readBit();
+	return in.read(len);
+}
+
+// the table decoder looks at the next GAMMA_TABLE_BITS bits: each entry has
+// the codes that fit whole in them (at most GAMMA_TABLE_CODES)
+#define GAMMA_TABLE_BITS 12
+#define GAMMA_TABLE_CODES 8
+
+struct GammaEntry {
+	unsigned char count;
+	unsigned char value[GAMMA_TABLE_CODES];
+};
+
+class GammaTable {
+  private:
+	GammaEntry entries[1 << GAMMA_TABLE_BITS];
+
+  public:
+	GammaTable(bool addOne) {
+		for(unsigned int bits = 0; bits < (1u << GAMMA_TABLE_BITS); bits++) {
+			GammaEntry & e = entries[bits];
+			e.count = 0;
+			unsigned int pos = 0;
+			while(e.count < GAMMA_TABLE_CODES) {
+				// the zeros before the next 1, then the code if it ends in the window
+				unsigned int zeros = 0;
+				while(pos + zeros < GAMMA_TABLE_BITS && !(bits >> (GAMMA_TABLE_BITS - 1 - pos - zeros) & 1)) zeros++;
+				unsigned int length = 2 * zeros + 1 + addOne;
+				if(pos + length > GAMMA_TABLE_BITS) break;
+				unsigned int end = GAMMA_TABLE_BITS - pos - length;
+				e.value[e.count++] = bits >> end & ((1u << (zeros + 1)) - 1);
+				pos += length;
+			}
+		}
+	}
+	const GammaEntry & operator [] (unsigned int bits) const { return entries[bits]; }
+};
+
+inline const GammaTable & gammaTable(bool addOne) {
+	static const GammaTable tables[2] = {GammaTable(false), GammaTable(true)};
+	return tables[addOne];
+}
+
+inline unsigned long long readGamma(BitReader & in, bool addOne = true) {
+	// the table is only used away from the end, where the window is all real bits
+	if(in.left() >= GAMMA_TABLE_BITS) {
+		const GammaEntry & e = gammaTable(addOne)[in.peek(GAMMA_TABLE_BITS)];
+		if(e.count) {
+			in.read(gammaLength(e.value[0], addOne));
+			return e.value[0];
+		}
+	}
+	return readGammaSlow(in, addOne);
+}
+
+// reads up to count codes from in into out, several per table lookup when they
+// are short; returns the number read, which is less than count only at the end
+inline unsigned int readGammas(BitReader & in, unsigned long long * out, unsigned int count, bool addOne = true) {
+	const GammaTable & table = gammaTable(addOne);
+	unsigned int got = 0;
+	while(got < count && !in.eof()) {
+		if(in.left() >= GAMMA_TABLE_BITS) {
+			const GammaEntry & e = table[in.peek(GAMMA_TABLE_BITS)];
+			if(e.count) {
+				unsigned int bits = 0;
+				for(unsigned int i = 0; i < e.count && got < count; i++) {
+					out[got++] = e.value[i];
+					bits += gammaLength(e.value[i], addOne);
+				}
+				in.read(bits);
+				continue;
+			}
+		}
+		out[got++] = readGammaSlow(in, addOne);
+	}
+	return got;
+}
+
+#endif
@@ -0,0 +1,244 @@
+#include "global_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+bool GlobalCacheKey::operator == (const GlobalCacheKey & other) const {
+	return prevLetter == other.prevLetter && encodingChars == other.encodingChars
+		&& fingerprint == other.fingerprint && group == other.group;
+}
+
+size_t GlobalCacheKeyHash::operator () (const GlobalCacheKey & key) const {
+	unsigned long long h = hash<string>()(key.group);
+	unsigned long long rest[3] = {(unsigned char) key.prevLetter, (unsigned long long) key.encodingChars, key.fingerprint};
+	for(int i = 0; i < 3; i++) {
+		h ^= rest[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+
+GlobalCache::GlobalCache(unsigned long long capacity, unsigned int numShards): numShards(numShards) {
+	shardCapacity = (capacity + numShards - 1) / numShards;
+	if(shardCapacity == 0) shardCapacity = 1;
+	shards = new Shard[numShards];
+	for(unsigned int i = 0; i < numShards; i++) {
+		omp_init_lock(&shards[i].lock);
+		shards[i].hand = 0;
+		shards[i].hits = shards[i].misses = shards[i].evictions = 0;
+	}
+}
+
+GlobalCache::~GlobalCache() {
+	for(unsigned int i = 0; i < numShards; i++) omp_destroy_lock(&shards[i].lock);
+	delete [] shards;
+}
+
+GlobalCache::Shard & GlobalCache::shardOf(const GlobalCacheKey & key) const {
+	// the low bits of the hash pick the bucket in the shard, so the shard uses the high ones
+	return shards[(GlobalCacheKeyHash()(key) >> 32) % numShards];
+}
+
+bool GlobalCache::find(const GlobalCacheKey & key, CompressedWords & value) {
+	Shard & shard = shardOf(key);
+	omp_set_lock(&shard.lock);
+	unordered_map<GlobalCacheKey, unsigned int, GlobalCacheKeyHash>::iterator it = shard.index.find(key);
+	bool found = it != shard.index.end();
+	if(found) {
+		Slot & slot = shard.slots[it->second];
+		slot.referenced = true;
+		value = slot.value;
+		shard.hits++;
+	} else shard.misses++;
+	omp_unset_lock(&shard.lock);
+	return found;
+}
+
+void GlobalCache::insert(const GlobalCacheKey & key, const CompressedWords & value) {
+	Shard & shard = shardOf(key);
+	omp_set_lock(&shard.lock);
+	unordered_map<GlobalCacheKey, unsigned int, GlobalCacheKeyHash>::iterator it = shard.index.find(key);
+	if(it != shard.index.end()) {
+		shard.slots[it->second].value = value;
+	} else if(shard.slots.size() < shardCapacity) {
+		Slot slot;
+		slot.key = key;
+		slot.value = value;
+		slot.referenced = false;
+		shard.index[key] = shard.slots.size();
+		shard.slots.push_back(slot);
+	} else {
+		// the hand clears the referenced slots it passes, and evicts the first other one
+		while(shard.slots[shard.hand].referenced) {
+			shard.slots[shard.hand].referenced = false;
+			shard.hand = (shard.hand + 1) % shardCapacity;
+		}
+		Slot & slot = shard.slots[shard.hand];
+		shard.index.erase(slot.key);
+		slot.key = key;
+		slot.value = value;
+		shard.index[key] = shard.hand;
+		shard.hand = (shard.hand + 1) % shardCapacity;
+		shard.evictions++;
+	}
+	omp_unset_lock(&shard.lock);
+}
+
+unsigned long long GlobalCache::size() const {
+	unsigned long long total = 0;
+	for(unsigned int i = 0; i < numShards; i++) {
+		omp_set_lock(&shards[i].lock);
+		total += shards[i].slots.size();
+		omp_unset_lock(&shards[i].lock);
+	}
+	return total;
+}
+
+unsigned long long GlobalCache::total(unsigned long long Shard::* counter) const {
+	unsigned long long total = 0;
+	for(unsigned int i = 0; i < numShards; i++) {
+		omp_set_lock(&shards[i].lock);
+		total += shards[i].*counter;
+		omp_unset_lock(&shards[i].lock);
+	}
+	return total;
+}
+
+unsigned long long GlobalCache::hits() const { return total(&Shard::hits); }
+
+unsigned long long GlobalCache::misses() const { return total(&Shard::misses); }
+
+unsigned long long GlobalCache::evictions() const { return total(&Shard::evictions); }
+
+
+// the numbers of the cache file, n bytes each, highest first
+static void putNumber(string & out, unsigned long long value, int n) {
+	for(int shift = 8 * (n - 1); shift >= 0; shift -= 8) out += (char) (value >> shift);
+}
+
+static void putString(string & out, const string & s) {
+	putNumber(out, s.size(), 4);
+	out += s;
+}
+
+// reads the numbers and strings written by putNumber and putString; every read
+// fails once one has gone past the end
+class CacheReader {
+  private:
+	const string & data;
+	unsigned long long pos;
+	bool failed;
+
+  public:
+	CacheReader(const string & data): data(data), pos(0), failed(false) {}
+	bool ok() const { return !failed; }
+	bool done() const { return pos >= data.size(); }
+	unsigned long long number(int n) {
+		if(failed || pos + n > data.size()) {
+			failed = true;
+			return 0;
+		}
+		unsigned long long value = 0;
+		for(int i = 0; i < n; i++) value = (value << 8) | (unsigned char) data[pos++];
+		return value;
+	}
+	string text(unsigned long long n) {
+		if(failed || pos + n > data.size()) {
+			failed = true;
+			return "";
+		}
+		pos += n;
+		return data.substr(pos - n, n);
+	}
+	string text() { return text(number(4)); }
+};
+
+bool GlobalCache::save(const string & path) const {
+	string out = GLOBAL_CACHE_MAGIC;
+	putNumber(out, GLOBAL_CACHE_VERSION, 4);
+	string entries;
+	unsigned long long count = 0;
+	for(unsigned int i = 0; i < numShards; i++) {
+		omp_set_lock(&shards[i].lock);
+		for(vector<Slot>::const_iterator it = shards[i].slots.begin(); it != shards[i].slots.end(); it++) {
+			const GlobalCacheKey & key = it->key;
+			const CompressedWords & value = it->value;
+			putString(entries, key.group);
+			putNumber(entries, (unsigned char) key.prevLetter, 1);
+			putNumber(entries, key.encodingChars, 1);
+			putNumber(entries, key.fingerprint, 8);
+
+			unsigned int ratio;
+			memcpy(&ratio, &value.ratio, sizeof(ratio));
+			putNumber(entries, ratio, 4);
+			putString(entries, value.words);
+			putNumber(entries, value.numLetters, 4);
+			putNumber(entries, value.index, 8);
+			putNumber(entries, value.usedLast, 1);
+			putNumber(entries, value.usesLocalDict, 1);
+			putString(entries, value.encodingScheme);
+			putNumber(entries, (unsigned char) value.prevLetter, 1);
+			putNumber(entries, value.revealedChars.size(), 4);
+			for(vector<int>::const_iterator c = value.revealedChars.begin(); c != value.revealedChars.end(); c++) putNumber(entries, *c, 4);
+			putNumber(entries, value.compressedBits.size(), 8);
+			entries += value.compressedBits.bytes();
+			count++;
+		}
+		omp_unset_lock(&shards[i].lock);
+	}
+	putNumber(out, count, 8);
+	out += entries;
+
+	string temporary = path + ".tmp";
+	ofstream file(temporary.c_str(), ios::binary);
+	file << out;
+	file.close();
+	if(!file) return false;
+	return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool GlobalCache::load(const string & path) {
+	ifstream file(path.c_str(), ios::binary);
+	if(!file) return false;
+	stringstream buffer;
+	buffer << file.rdbuf();
+	string data = buffer.str();
+
+	CacheReader in(data);
+	if(in.text(strlen(GLOBAL_CACHE_MAGIC)) != GLOBAL_CACHE_MAGIC || in.number(4) != GLOBAL_CACHE_VERSION) return false;
+	unsigned long long count = in.number(8);
+	for(unsigned long long i = 0; i < count && in.ok(); i++) {
+		GlobalCacheKey key;
+		key.group = in.text();
+		key.prevLetter = in.number(1);
+		key.encodingChars = in.number(1);
+		key.fingerprint = in.number(8);
+
+		CompressedWords value;
+		unsigned int ratio = in.number(4);
+		memcpy(&value.ratio, &ratio, sizeof(ratio));
+		value.words = in.text();
+		value.numLetters = (int) in.number(4);
+		value.index = in.number(8);
+		value.usedLast = in.number(1);
+		value.usesLocalDict = in.number(1);
+		value.encodingScheme = in.text();
+		value.prevLetter = in.number(1);
+		unsigned long long numRevealed = in.number(4);
+		for(unsigned long long c = 0; c < numRevealed && in.ok(); c++) value.revealedChars.push_back((int) in.number(4));
+		unsigned long long bits = in.number(8);
+		string packed = in.text((bits + 7) / 8);
+		if(!in.ok()) break;
+		BitReader reader(packed, bits);
+		for(unsigned long long left = bits; left > 0; left -= (left < 64 ? left : 64)) {
+			unsigned int n = left < 64 ? left : 64;
+			value.compressedBits.write(reader.read(n), n);
+		}
+		insert(key, value);
+	}
+	return in.ok() && in.done();
+}
@@ -0,0 +1,81 @@
+#ifndef __GLOBAL_CACHE_H__
+#define __GLOBAL_CACHE_H__
+#include <omp.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "wordclass.h"
+
+// the best global dictionary compression of a group of words (as found by
+// tryAllLetters) only depends on the group, the last letter of the group before
+// it, the chars scheme and the trie, so it is cached across documents under them
+struct GlobalCacheKey {
+	std::string group;
+	char prevLetter;
+	int encodingChars;
+	unsigned long long fingerprint;	// of the trie (see trie::fingerprint) and the char codes
+	bool operator == (const GlobalCacheKey & other) const;
+};
+
+struct GlobalCacheKeyHash {
+	size_t operator () (const GlobalCacheKey & key) const;
+};
+
+// cache file: GLOBAL_CACHE_MAGIC, the version, the number of entries, then the
+// entries, all numbers highest byte first (version 2: the chars without a code
+// are escaped, see chars.h; version 3: the rank of each entry)
+#define GLOBAL_CACHE_MAGIC "GLBCACHE"
+#define GLOBAL_CACHE_VERSION 3
+
+// the default number of entries kept
+#define GLOBAL_CACHE_SIZE 65536
+
+// a bounded cache that threads can share: the entries are split in shards by
+// hash, each with its own lock, and a full shard evicts with the CLOCK algorithm
+// (an entry found since the hand last passed it gets a second chance)
+class GlobalCache {
+  private:
+	struct Slot {
+		GlobalCacheKey key;
+		CompressedWords value;
+		bool referenced;
+	};
+	struct Shard {
+		omp_lock_t lock;
+		std::vector<Slot> slots;
+		std::unordered_map<GlobalCacheKey, unsigned int, GlobalCacheKeyHash> index;
+		unsigned int hand;
+		unsigned long long hits, misses, evictions;
+	};
+	Shard * shards;
+	unsigned int numShards;
+	unsigned int shardCapacity;
+	Shard & shardOf(const GlobalCacheKey & key) const;
+	// the sum of a counter over the shards
+	unsigned long long total(unsigned long long Shard::* counter) const;
+	GlobalCache(const GlobalCache &);
+	GlobalCache & operator = (const GlobalCache &);
+
+  public:
+	// keeps at most capacity entries (rounded up to a multiple of numShards)
+	GlobalCache(unsigned long long capacity = GLOBAL_CACHE_SIZE, unsigned int numShards = 16);
+	~GlobalCache();
+	// copies the compression cached for key into value; false if there is none
+	bool find(const GlobalCacheKey & key, CompressedWords & value);
+	void insert(const GlobalCacheKey & key, const CompressedWords & value);
+
+	unsigned long long size() const;
+	unsigned long long capacity() const { return (unsigned long long) numShards * shardCapacity; }
+	unsigned long long hits() const;
+	unsigned long long misses() const;
+	unsigned long long evictions() const;
+
+	// writes all the entries to path (through a temporary file, so a reader never
+	// sees half a cache)
+	bool save(const std::string & path) const;
+	// adds the entries of a file written by save; false if it is missing or
+	// damaged (the entries before the damage are kept)
+	bool load(const std::string & path);
+};
+
+#endif
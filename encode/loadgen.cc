@@ -0,0 +1,110 @@
+#include "client.h"
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+using namespace std;
+
+// the latency (in milliseconds) that a fraction q of the sorted latencies are under
+static double percentile(const vector<double> & latencies, double q){
+	if(latencies.empty()) return 0;
+	unsigned long long i = q * latencies.size();
+	return 1000 * latencies[min(i, (unsigned long long) latencies.size() - 1)];
+}
+
+static void report(const string & name, vector<double> & latencies, double seconds){
+	if(latencies.empty()) return;
+	sort(latencies.begin(), latencies.end());
+	double total = 0;
+	for(unsigned int i = 0; i < latencies.size(); i++) total += latencies[i];
+	cout << name << ": " << latencies.size() << " requests, " << latencies.size() / seconds << " per second, mean "
+		<< 1000 * total / latencies.size() << " ms, p50 " << percentile(latencies, 0.5) << " ms, p99 "
+		<< percentile(latencies, 0.99) << " ms, max " << percentile(latencies, 1) << " ms" << endl;
+}
+
+// sends the lines of file as compress requests to the daemon (see server.h),
+// from clients connections at once, and prints the latencies of the replies;
+// -verify also decompresses each reply and checks it is the line again
+//   loadgen [-socket path] [-clients n] [-requests n] [-deadline ms] [-verify] file
+int main(int argc, char ** argv){
+	string path = "codec.sock";
+	int clients = 4;
+	int requests = 1000;
+	unsigned int deadline = 0;
+	bool verify = false;
+	string file = "";
+	for(int i = 1; i < argc; i++){
+		if(string(argv[i]) == "-socket" && i + 1 < argc) path = argv[++i];
+		else if(string(argv[i]) == "-clients" && i + 1 < argc) clients = atoi(argv[++i]);
+		else if(string(argv[i]) == "-requests" && i + 1 < argc) requests = atoi(argv[++i]);
+		else if(string(argv[i]) == "-deadline" && i + 1 < argc) deadline = strtoul(argv[++i], NULL, 10);
+		else if(string(argv[i]) == "-verify") verify = true;
+		else if(argv[i][0] != '-' && file == "") file = argv[i];
+		else {
+			cerr << "Unknown option \"" << argv[i] << "\"" << endl;
+			return 1;
+		}
+	}
+	if(clients < 1) clients = 1;
+
+	ifstream in(file.c_str());
+	vector<string> payloads;
+	string line;
+	while(getline(in, line)) if(line != "") payloads.push_back(line);
+	if(payloads.empty()) {
+		cerr << "loadgen [-socket path] [-clients n] [-requests n] [-deadline ms] [-verify] file" << endl;
+		return 1;
+	}
+
+	// each client goes through the payloads from its own place
+	vector< vector<double> > compressTimes(clients), decompressTimes(clients);
+	vector<int> errors(clients, 0), late(clients, 0), wrong(clients, 0);
+	double start = omp_get_wtime();
+	#pragma omp parallel for num_threads(clients) schedule(static, 1)
+	for(int c = 0; c < clients; c++){
+		CodecClient client(path);
+		for(int r = c; r < requests; r += clients){
+			const string & text = payloads[r % payloads.size()];
+			string data, back;
+			double t = omp_get_wtime();
+			int status = client.compress(text, data, deadline);
+			compressTimes[c].push_back(omp_get_wtime() - t);
+			if(status == SERVER_DEADLINE) late[c]++;
+			if(status != SERVER_OK) {
+				errors[c]++;
+				continue;
+			}
+			if(!verify) continue;
+			t = omp_get_wtime();
+			status = client.decompress(data, back, deadline);
+			decompressTimes[c].push_back(omp_get_wtime() - t);
+			if(status == SERVER_DEADLINE) late[c]++;
+			if(status != SERVER_OK) errors[c]++;
+			else if(back != text) wrong[c]++;
+		}
+	}
+	double seconds = omp_get_wtime() - start;
+
+	vector<double> compressAll, decompressAll;
+	int errorCount = 0, lateCount = 0, wrongCount = 0;
+	for(int c = 0; c < clients; c++){
+		compressAll.insert(compressAll.end(), compressTimes[c].begin(), compressTimes[c].end());
+		decompressAll.insert(decompressAll.end(), decompressTimes[c].begin(), decompressTimes[c].end());
+		errorCount += errors[c];
+		lateCount += late[c];
+		wrongCount += wrong[c];
+	}
+	cout << clients << " clients, " << seconds << " s" << endl;
+	report("compress", compressAll, seconds);
+	report("decompress", decompressAll, seconds);
+	cout << errorCount << " errors (" << lateCount << " past the deadline), " << wrongCount << " wrong texts" << endl;
+
+	CodecClient client(path);
+	string stats;
+	if(client.stats(stats) == SERVER_OK) cout << "server:" << endl << stats;
+	return errorCount || wrongCount;
+}
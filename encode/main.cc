@@ -2,72 +2,263 @@
 #include "encode.h"
 #include "decode.h"
 #include "create_suffix.h"
+#include "global_cache.h"
+#include "stream.h"
+#include "codec.h"
+#include "server.h"
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <cstdlib>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
-int USELASTLETTER = 0;
-int ENCODINGCHARS = 0;
-
-// converts first number from in to an int
-int convertInt(istringstream & in, bool addOne = true){
-        // length of number in binary, obtained by reading all 0s at the start
-        int i = 1;
-        char c;
-        while(in >> c && c == '0') i++;
-        // the number in binary
-        stringstream num;
-        if(!addOne) in.putback(c);
-
-        while(i > 0 && in >> c){
-                num << c;
-                i--;
-        }
-
-        // the desired number in binary
-        int binary;
-        num >> binary;
-        // converts binary to int
-
-        int factor = 1;
-        // the result
-        int total = 0;
-
-        while (binary != 0) {
-                total += (binary % 10) * factor;
-                binary /= 10;
-                factor *= 2;
-        }
-
-        return total;
+// compress writes file + COMPRESSED_SUFFIX; decompress writes file without it
+// (or file + DECOMPRESSED_SUFFIX, if file does not end with it)
+#define COMPRESSED_SUFFIX ".cmp"
+#define DECOMPRESSED_SUFFIX ".out"
+
+// the options of compress and decompress
+struct BatchOptions {
+	unsigned long long blockSize;
+	unsigned long long blockPhrases;
+	// where "-" writes to, as cout is silenced
+	ostream * standardOut;
+};
+
+// compresses file ("-": stdin to standardOut) as a stream of blocks, with
+// threads threads
+static bool compressFile(const string & file, const Compressor & compressor, const BatchOptions & options, int threads){
+	if(compressor.failed()) return false;
+	if(file == "-"){
+		compressor.compress(cin, *options.standardOut, options.blockSize, options.blockPhrases, threads);
+		return options.standardOut->good();
+	}
+	ifstream in(file.c_str(), ios::binary);
+	if(!in) return false;
+	ofstream out((file + COMPRESSED_SUFFIX).c_str(), ios::binary);
+	if(!out) return false;
+	compressor.compress(in, out, options.blockSize, options.blockPhrases, threads);
+	return out.good();
+}
+
+// decompresses the stream of blocks in file ("-": stdin to stdout), with threads
+// threads
+static bool decompressFile(const string & file, const Decompressor & decompressor, int threads){
+	if(file == "-") return decompressor.decompress(0, 1, NULL, threads);
+
+	string name = file;
+	string suffix = COMPRESSED_SUFFIX;
+	if(name.length() > suffix.length() && name.compare(name.length() - suffix.length(), suffix.length(), suffix) == 0)
+		name.erase(name.length() - suffix.length());
+	else name += DECOMPRESSED_SUFFIX;
+
+	int in = open(file.c_str(), O_RDONLY);
+	if(in < 0) return false;
+	int out = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	bool ok = out >= 0 && decompressor.decompress(in, out, NULL, threads);
+	close(in);
+	if(out >= 0) ok = close(out) == 0 && ok;
+	return ok;
+}
+
+// compresses (or decompresses) all the files with the one context, a file per
+// thread (or, for a single file, a block per thread); returns the exit status
+static int runBatch(bool compress, const vector<string> & files, const Compressor & compressor, const Decompressor & decompressor,
+	const BatchOptions & options){
+	int n = files.size();
+	int threads = (n > 1) ? 1 : 0;
+	int failed = 0;
+	#pragma omp parallel for schedule(dynamic) reduction(+:failed) if(n > 1)
+	for(int i = 0; i < n; i++){
+		bool ok = compress ? compressFile(files[i], compressor, options, threads) : decompressFile(files[i], decompressor, threads);
+		if(!ok){
+			#pragma omp critical
+			cerr << "Could not " << (compress ? "compress" : "decompress") << " \"" << files[i] << "\"" << endl;
+			failed++;
+		}
+	}
+	return failed ? 1 : 0;
 }
 
+// main [-bits] [-range] [-block n] [-phrases n] [-cache file] [-cachesize n]:
+// -bits splits the phrases into the word groups with the fewest total bits,
+// instead of the lowest average ratio; -range writes "output" range coded
+// instead of with the gamma codes; -block streams "input" to "output" in blocks
+// of at most n chars, one block per OpenMP thread at a time (see stream.h), and
+// -phrases ends each block after n phrases, so the command range can decode any
+// phrases of "output" from the block they are in; -cache keeps a global cache
+// in file between runs, and -cachesize bounds it (either one turns it on)
+//
+// main compress|decompress [-chars n|f|h] [-list file] [options] [file ...]:
+// compresses each file to file.cmp (as a stream of blocks), or decompresses
+// each file.cmp to file, without asking anything; "-" (or no file at all) is
+// stdin to stdout, and -list adds the files named in file, one per line
+//
+// main serve [-socket path] [-workers n] [-chars n|f|h] [options]: loads the
+// trie once and serves compress and decompress requests on the Unix socket
+// path (codec.sock) with n workers, until SIGINT or SIGTERM (see server.h)
+int main (int argc, char ** argv){
+	EncodeOptions options;
+	string cacheFile = "";
+	unsigned long long cacheSize = GLOBAL_CACHE_SIZE;
+	bool useCache = false;
+	bool rangeCoded = false;
+	unsigned long long blockSize = 0;
+	unsigned long long blockPhrases = 0;
+
+	string batch = (argc > 1) ? argv[1] : "";
+	bool batchMode = batch == "compress" || batch == "decompress";
+	bool serveMode = batch == "serve";
+	string socketPath = SERVER_SOCKET;
+	int workers = 0;
+	vector<string> files;
+	string chars = "n";
+	for(int i = (batchMode || serveMode) ? 2 : 1; i < argc; i++){
+		if(string(argv[i]) == "-bits") options.segmentation = 1;
+		else if(string(argv[i]) == "-range") rangeCoded = true;
+		else if(string(argv[i]) == "-block" && i + 1 < argc) blockSize = strtoull(argv[++i], NULL, 10);
+		else if(string(argv[i]) == "-phrases" && i + 1 < argc) blockPhrases = strtoull(argv[++i], NULL, 10);
+		else if(string(argv[i]) == "-cache" && i + 1 < argc) {
+			cacheFile = argv[++i];
+			useCache = true;
+		} else if(string(argv[i]) == "-cachesize" && i + 1 < argc) {
+			cacheSize = strtoull(argv[++i], NULL, 10);
+			useCache = true;
+		}
+		else if(string(argv[i]) == "-chars" && i + 1 < argc) chars = argv[++i];
+		else if(serveMode && string(argv[i]) == "-socket" && i + 1 < argc) socketPath = argv[++i];
+		else if(serveMode && string(argv[i]) == "-workers" && i + 1 < argc) workers = atoi(argv[++i]);
+		else if(string(argv[i]) == "-list" && i + 1 < argc) {
+			ifstream list(argv[++i]);
+			if(!list) {
+				cerr << "Could not read \"" << argv[i] << "\"" << endl;
+				return 1;
+			}
+			string file;
+			while(getline(list, file)) if(file != "") files.push_back(file);
+		} else if(batchMode && (argv[i][0] != '-' || string(argv[i]) == "-")) files.push_back(argv[i]);
+		else {
+			cerr << "Unknown option \"" << argv[i] << "\"" << endl;
+			return 1;
+		}
+	}
+	if(blockPhrases > 0 && blockSize == 0) blockSize = STREAM_BLOCK_SIZE;
+	if(blockSize > STREAM_MAX_BLOCK_SIZE) {
+		cerr << "-block is at most " << STREAM_MAX_BLOCK_SIZE << endl;
+		return 1;
+	}
+	if(chars != "n" && chars != "f" && chars != "h") {
+		cerr << "-chars is n, f or h" << endl;
+		return 1;
+	}
+
+	// the comments of the codec go nowhere in batch mode, as "-" writes to
+	// stdout, nor in a daemon; the interactive mode prints some details
+	ostream standardOut(cout.rdbuf());
+	if(batchMode || serveMode) {
+		cout.rdbuf(NULL);
+		if(batchMode && files.empty()) files.push_back("-");
+	} else options.summary = options.end = options.stats = true;
+
+	GlobalCache * cache = useCache ? new GlobalCache(cacheSize) : NULL;
+	if(cacheFile != "" && cache->load(cacheFile)) cout << "Loaded " << cache->size() << " entries from \"" << cacheFile << "\"" << endl;
+	options.cache = cache;
+
+	// the Huffman codes of the chars, written next to the snapshot by build_snapshot
+	huffman_table charCodes;
+	bool haveCodes = charCodes.load("CharCodes.bin");
+
+	// maps the snapshot written by create-trie/build_snapshot if there is one,
+	// otherwise builds the trie from the corpus (and the codes, if there are none)
+	trie * GlobalSuffixTrie = new trie;
+	if(!GlobalSuffixTrie->load("SuffixTrie.bin")){
+		delete GlobalSuffixTrie;
+		char_counts counts;
+		GlobalSuffixTrie = readCorpus(haveCodes ? NULL : &counts);
+		if(!haveCodes) charCodes.build(counts, true);
+		haveCodes = true;
+	}
+	const HuffmanChars * huffman = haveCodes ? new HuffmanChars(charCodes) : NULL;
+	options.huffman = huffman;
+
+	// a snapshot without CharCodes.bin has no Huffman codes: as in the interactive
+	// mode, -chars h is refused, rather than written as gamma codes under scheme 2
+	if((serveMode || batch == "compress") && chars == "h" && !huffman) {
+		cerr << "-chars h needs \"CharCodes.bin\" next to \"SuffixTrie.bin\"" << endl;
+		delete cache;
+		delete GlobalSuffixTrie;
+		return 1;
+	}
 
-int main (){
-	trie * GlobalSuffixTrie = readCorpus();
+	if(serveMode) {
+		options.encodingChars = (chars == "n") ? 0 : (chars == "f") ? 1 : 2;
+		const Compressor compressor(GlobalSuffixTrie, options, rangeCoded);
+		const Decompressor decompressor(GlobalSuffixTrie, huffman, false, SERVER_MAX_PAYLOAD);
+		int status = 0;
+		{
+			CodecServer server(socketPath, compressor, decompressor, workers);
+			if(server.listening()) {
+				cerr << "Serving on \"" << socketPath << "\"" << endl;
+				server.run();
+			} else {
+				cerr << "Could not listen on \"" << socketPath << "\"" << endl;
+				status = 1;
+			}
+		}
+
+		if(cacheFile != "" && !cache->save(cacheFile)) cerr << "Could not write \"" << cacheFile << "\"" << endl;
+		cout.rdbuf(standardOut.rdbuf());
+		delete cache;
+		delete huffman;
+		delete GlobalSuffixTrie;
+		return status;
+	}
+
+	if(batchMode) {
+		options.encodingChars = (chars == "n") ? 0 : (chars == "f") ? 1 : 2;
+		BatchOptions batchOptions;
+		batchOptions.blockSize = blockSize ? blockSize : STREAM_BLOCK_SIZE;
+		batchOptions.blockPhrases = blockPhrases;
+		batchOptions.standardOut = &standardOut;
+		int status = runBatch(batch == "compress", files, Compressor(GlobalSuffixTrie, options, rangeCoded),
+			Decompressor(GlobalSuffixTrie, huffman), batchOptions);
+
+		if(cacheFile != "" && !cache->save(cacheFile)) cerr << "Could not write \"" << cacheFile << "\"" << endl;
+		cout.rdbuf(standardOut.rdbuf());
+		delete cache;
+		delete huffman;
+		delete GlobalSuffixTrie;
+		return status;
+	}
+
+	// the fields are printed as they are decoded
+	const Decompressor decompressor(GlobalSuffixTrie, huffman, true);
 //cout << "READ" << endl;
-//	GlobalSuffixTrie->traverse_trie();
 	bool quit = false;
 	string command = "";
 
 	while(!quit){
 		command = "";
-		while(command != "encode" && command != "decode" && command != "quit"){
-			cout << "Enter a command (encode, decode, quit) : ";
+		while(command != "encode" && command != "decode" && command != "range" && command != "quit"){
+			cout << "Enter a command (encode, decode, range, quit) : ";
 			cin >> command;
 		} // while
 
 		if(command == "encode") {
 			string inputType = "";
 
-                        while(inputType != "f" && inputType != "n"){
-                                cout << "Do you want to use normal encoding scheme for chars, or use the frequencies of letters (n/f)?";
+                        while(inputType != "f" && inputType != "n" && (inputType != "h" || !huffman)){
+                                cout << "Do you want to use normal encoding scheme for chars, the frequencies of letters, or the Huffman codes of the corpus (n/f/h)?";
                                 cin >> inputType;
                         }
-                        if(inputType == "n") ENCODINGCHARS = 0;
-                        else ENCODINGCHARS = 1;
+                        if(inputType == "n") options.encodingChars = 0;
+                        else if(inputType == "f") options.encodingChars = 1;
+                        else options.encodingChars = 2;
+                        const Compressor compressor(GlobalSuffixTrie, options, rangeCoded);
 
                         inputType = "";
 
@@ -76,7 +267,17 @@ int main (){
 				cin >> inputType;
 			}	
 
-			string Result;
+			BitWriter Result;
+			string packed;
+
+			if(inputType == "f" && blockSize > 0){
+				// the text never has to fit in memory
+				ifstream in("input", ios::binary);
+				ofstream out("output", ios::binary);
+				unsigned long long bytes = compressor.compress(in, out, blockSize, blockPhrases);
+				cout << "Wrote " << bytes << " bytes to \"output\"" << endl;
+				continue;
+			}
 
 			if(inputType == "k"){
 
@@ -84,27 +285,29 @@ int main (){
 			        string s;
 				getline(cin,s);
 				getline(cin,s);
-			        Result = bestCompression(s,GlobalSuffixTrie);
+			        packed = compressor.compress(s, Result);
 			} else {
 				cout << "Read the file \"input\"" << endl;
 				ifstream in("input");                                
 				stringstream buffer;
 				buffer << in.rdbuf();
-				Result = bestCompression(buffer.str(),GlobalSuffixTrie);
+				packed = compressor.compress(buffer.str(), Result);
 			}
-                        cout << "RESULT : " << endl << Result << endl;
-                        ofstream out ("output");
-                        out << Result; 
+                        // prints the bits as text (for debugging), and writes them packed
+                        cout << "RESULT : " << endl << Result.text() << endl;
+                        ofstream out ("output", ios::binary);
+                        if(rangeCoded) cout << "Range coded " << Result.size() << " bits in " << packed.size() - CODEC_HEADER_SIZE << " bytes" << endl;
+                        out << packed;
 
 		} else if(command == "decode") {
 			string inputType = "";
 
-                        while(inputType != "f" && inputType != "n"){
-                                cout << "Do you want to use normal encoding scheme for chars, or use the frequencies of letters (n/f)?";
+                        while(inputType != "f" && inputType != "n" && (inputType != "h" || !huffman)){
+                                cout << "Do you want to use normal encoding scheme for chars, the frequencies of letters, or the Huffman codes of the corpus (n/f/h)?";
                                 cin >> inputType;
                         }
-                        if(inputType == "n") ENCODINGCHARS = 0;
-                        else ENCODINGCHARS = 1;
+                        // the scheme of the bits from the keyboard (a file says its own)
+                        int encodingChars = (inputType == "n") ? 0 : (inputType == "f") ? 1 : 2;
 
                         inputType = "";
 
@@ -116,25 +319,89 @@ int main (){
                         string Result;
 
                         if(inputType == "k"){
+                        	// the bits as text, as printed by encode
                         	cout << "Enter the binary string to be decoded : ";
                                 string s;
-                        	istringstream in (s);
-                                Result = decodeText(in,GlobalSuffixTrie);
+                                cin >> s;
+                                BitWriter bits;
+                                for(unsigned int i = 0; i < s.length(); i++) bits.writeBit(s[i] == '1');
+                                string packed = bits.bytes();
+                        	BitReader in (packed, bits.size());
+                                if(!decompressor.decodeBits(in, encodingChars, Result)) {
+                                	cout << "The bits are broken" << endl;
+                                	continue;
+                                }
                         } else {
                                 cout << "Read the file \"output\"" << endl;
-                                ifstream inp("output");
+                                ifstream inp("output", ios::binary);
+
+                                // a stream of blocks is decoded straight to "message", block by block
+                                char header[CODEC_HEADER_SIZE];
+                                int format, headerChars;
+                                unsigned long long size;
+                                if(inp.read(header, CODEC_HEADER_SIZE) && readCodecHeader(string(header, CODEC_HEADER_SIZE), format, headerChars, size)
+                                	&& format == CODEC_BLOCKS) {
+                                	int in = open("output", O_RDONLY);
+                                	int out = open("message", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                                	unsigned long long chars = 0;
+                                	bool ok = in >= 0 && out >= 0 && decompressor.decompress(in, out, &chars);
+                                	if(in >= 0) close(in);
+                                	if(out >= 0) close(out);
+                                	if(ok) cout << "Wrote " << chars << " chars to \"message\"" << endl;
+                                	else cout << "\"output\" has a broken block" << endl;
+                                	continue;
+                                }
+                                inp.seekg(0);
                                 stringstream buffer;
                                 buffer << inp.rdbuf();
-				istringstream in(buffer.str());
+                                string data = buffer.str();
 
-                                Result = decodeText(in,GlobalSuffixTrie);
+                                // the chars scheme comes from the header of the file
+                                if(!unpackCompressed(data, format, headerChars, size)) {
+                                	cout << "\"output\" is not a compressed file" << endl;
+                                	continue;
+                                }
+                                if(headerChars == 2 && !huffman) {
+                                	cout << "\"output\" needs the Huffman codes of CharCodes.bin" << endl;
+                                	continue;
+                                }
+                                if(!decompressor.decompress(data, Result)) {
+                                	cout << "\"output\" is broken" << endl;
+                                	continue;
+                                }
                         }
                         cout << "RESULT : " << endl << "\"" << Result << "\"" << endl;
                         ofstream out ("message");
                         out << Result;
 
+		} else if(command == "range") {
+			// phrases of the stream of blocks in "output", counted from 0
+			unsigned long long first, last;
+			cout << "Decode from phrase : ";
+			cin >> first;
+			cout << "To phrase : ";
+			cin >> last;
+
+			int fd = open("output", O_RDONLY);
+			string Result;
+			bool ok = false;
+			if(fd >= 0) {
+				ok = decompressor.decompressRange(fd, first, last + 1, Result);
+				close(fd);
+			}
+			if(!ok) {
+				cout << "\"output\" is not a stream of blocks with an index" << endl;
+				continue;
+			}
+			cout << "RESULT : " << endl << "\"" << Result << "\"" << endl;
+			ofstream out ("message");
+			out << Result;
+
 		} else quit = true;
 	} // while
+	if(cacheFile != "" && !cache->save(cacheFile)) cout << "Could not write \"" << cacheFile << "\"" << endl;
+	delete cache;
+	delete huffman;
 	delete GlobalSuffixTrie;
 }
 
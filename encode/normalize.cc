@@ -0,0 +1,147 @@
+#include "normalize.h"
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// finds the runs of a bit vector as rleEncode (wordclass.cc) does, as its bits
+// come: the first bit, then the length of each run
+class RunWriter {
+  private:
+	bool & first;
+	vector<unsigned long long> & runs;
+	bool current;
+	unsigned long long count;
+
+  public:
+	RunWriter(bool & first, vector<unsigned long long> & runs): first(first), runs(runs), current(false), count(0) {}
+	void write(bool bit, unsigned long long n = 1) {
+		if(count == 0) first = bit;
+		else if(bit != current) {
+			runs.push_back(count);
+			count = 0;
+		}
+		current = bit;
+		count += n;
+	}
+	// rleEncode starts an empty vector with a 1
+	void finish() {
+		if(count) runs.push_back(count);
+		else first = true;
+	}
+};
+
+// the number of lower case letters at the start of the n chars at p
+static inline unsigned long long lowerRun(const char * p, unsigned long long n){
+	unsigned long long i = 0;
+	// c is in 'a'..'z' when c - 'a' - 128, as a signed byte, is below 26 - 128
+#if defined(__AVX2__)
+	const __m256i shift = _mm256_set1_epi8((char) (0x80 - 'a'));
+	const __m256i bound = _mm256_set1_epi8((char) (0x80 + 26));
+	for(; i + 32 <= n; i += 32) {
+		__m256i c = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *) (p + i)), shift);
+		unsigned int lower = _mm256_movemask_epi8(_mm256_cmpgt_epi8(bound, c));
+		if(lower != 0xffffffffu) return i + __builtin_ctz(~lower);
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i shift128 = _mm_set1_epi8((char) (0x80 - 'a'));
+	const __m128i bound128 = _mm_set1_epi8((char) (0x80 + 26));
+	for(; i + 16 <= n; i += 16) {
+		__m128i c = _mm_add_epi8(_mm_loadu_si128((const __m128i *) (p + i)), shift128);
+		unsigned int lower = _mm_movemask_epi8(_mm_cmplt_epi8(c, bound128));
+		if(lower != 0xffff) return i + __builtin_ctz(~lower);
+	}
+#endif
+	while(i < n && p[i] >= 'a' && p[i] <= 'z') i++;
+	return i;
+}
+
+void normalizeText(const string & text, NormalizedText & result){
+	string & out = result.text;
+	out.clear();
+	out.reserve(text.length());
+	result.spaces.clear();
+	result.caseRuns.clear();
+	RunWriter caseBits(result.caseFirst, result.caseRuns);
+	vector<unsigned long long> & spaces = result.spaces;
+
+	// has there been any letter since the last period?
+	bool lastPeriod = true;
+	// the spaces: whether the last char was a space, how many there were, and
+	// whether the last other char was a period (or the start of the text)
+	bool space = false;
+	unsigned long long numSpaces = 0;
+	bool period = true;
+	bool newLine = false;
+
+	const char * p = text.data();
+	unsigned long long n = text.length();
+	for(unsigned long long i = 0; i < n; i++){
+		char c = p[i];
+		bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		if(letter) lastPeriod = false;
+
+		// the simplified char, and its bits in the vector
+		if(c == ',') {
+			caseBits.write(1);
+			caseBits.write(0);
+			c = ' ';
+		} else if(c >= 'A' && c <= 'Z') {
+			caseBits.write(1);
+			c = c - 'A' + 'a';
+		} else if(c == '.' && lastPeriod) {
+			// a period in a series of periods (with no letter between)
+			caseBits.write(1);
+			caseBits.write(1);
+			c = ' ';
+		} else {
+			if(c == '.') lastPeriod = true;
+			caseBits.write(0);
+		}
+
+		// the first newline of a series is dropped
+		if(c == '\n' && !newLine) {
+			newLine = true;
+			continue;
+		} else if(c != '\n') newLine = false;
+
+		if(c == ' ') {
+			space = true;
+			numSpaces++;
+			continue;
+		}
+		if(!space) {
+			// the spaces at the start of the text, or after a period (none)
+			if(period) spaces.push_back(1);
+			out += c;
+			// the spaces before a period that follows a char (none)
+			if(c == '.') spaces.push_back(1);
+		} else {
+			// a run of spaces is kept as one between words, and dropped next to
+			// a period
+			if(c != '.' && !period) out += ' ';
+			out += c;
+			spaces.push_back(numSpaces + 1);
+			numSpaces = 0;
+			space = false;
+		}
+		period = c == '.';
+
+		// the rest of a word is copied as it is: "0" bits, and no spaces
+		if(letter) {
+			unsigned long long run = lowerRun(p + i + 1, n - i - 1);
+			if(run) {
+				out.append(p + i + 1, run);
+				caseBits.write(0, run);
+				i += run;
+			}
+		}
+	}
+
+	// the spaces at the end, and the (no) spaces of an empty text
+	spaces.push_back(space ? numSpaces + 1 : 1);
+	if(out.empty()) spaces.push_back(1);
+	caseBits.finish();
+}
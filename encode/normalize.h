@@ -0,0 +1,31 @@
+#ifndef __NORMALIZE_H__
+#define __NORMALIZE_H__
+#include <string>
+#include <vector>
+
+// The text as the encoder simplifies it, in one pass over its chars:
+// - upper case letters become lower case, commas become spaces, and so do the
+//   periods after the first one of a series with no letter between; the bit
+//   vector of unsimplify (decode.cc) tells them apart: "0" for a char left as it
+//   is, "1" for an upper case letter, "10" for a comma, "11" for a period
+// - then the first newline of a series is dropped, and each run of spaces is
+//   collapsed into one (or none, next to a period or the start of the text); the
+//   numbers of spaces + 1 are kept in the order addSpaces (decode.cc) reads them
+// The bit vector is not kept: only its runs, as rleEncode would find them.
+//
+// The runs of lower case letters, most of the text, are found 32 chars at a
+// time with AVX2, or 16 with SSE2 (when the compiler targets them, e.g. with
+// -mavx2 or -march=native), and copied as they are.
+struct NormalizedText {
+	std::string text;
+	// the numbers of spaces + 1
+	std::vector<unsigned long long> spaces;
+	// the bit vector of the case, commas and periods, run length encoded: its
+	// first bit (1 when it is empty), then the length of each run
+	bool caseFirst;
+	std::vector<unsigned long long> caseRuns;
+};
+
+void normalizeText(const std::string & text, NormalizedText & result);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+#include <string>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+// The frames of the codec daemon (see server.h) on its Unix socket, all numbers
+// highest byte first. A client sends requests one after another on its
+// connection, and gets the reply of each before the next:
+//   request: the command (1 byte), the deadline in milliseconds from when the
+//            server reads the request (4 bytes, 0: none), the length of the
+//            payload (8 bytes), then the payload
+//   reply:   the status (1 byte), the length of the payload (8 bytes), then
+//            the payload
+// SERVER_COMPRESS: the text, replied with the compressed file (packCompressed or
+//                  packRangeCoded, in the chars scheme of the server)
+// SERVER_DECOMPRESS: a compressed file, replied with its text
+// SERVER_STATS: no payload, replied with the counters of the server as text, a
+//               "name value" line for each
+#define SERVER_COMPRESS 'C'
+#define SERVER_DECOMPRESS 'D'
+#define SERVER_STATS 'S'
+#define SERVER_REQUEST_HEADER 13
+#define SERVER_REPLY_HEADER 9
+
+// the statuses of the replies; SERVER_BROKEN is never sent, it is what the
+// client returns when the connection fails
+#define SERVER_OK 0
+#define SERVER_FAILED 1		// the payload could not be compressed (or decompressed)
+#define SERVER_DEADLINE 2	// the deadline passed before the reply was ready
+#define SERVER_BAD_REQUEST 3	// an unknown command, or a payload too long
+#define SERVER_BROKEN 4
+
+// the longest payload the server reads, and the longest text it decompresses.
+// Deadlines are only checked before and after the work, so a request holds
+// its worker until its whole payload is done: a full payload takes seconds
+// per MB to compress
+#define SERVER_MAX_PAYLOAD (64ULL << 20)
+
+// adds the lowest bytes bytes of n to data, highest first
+inline void putNumber(std::string & data, unsigned long long n, int bytes) {
+	for(int shift = 8 * (bytes - 1); shift >= 0; shift -= 8) data += (char) (n >> shift);
+}
+
+inline unsigned long long getNumber(const char * data, int bytes) {
+	unsigned long long n = 0;
+	for(int i = 0; i < bytes; i++) n = (n << 8) | (unsigned char) data[i];
+	return n;
+}
+
+// sends all of data on the socket fd (without SIGPIPE if the peer has gone)
+inline bool sendAll(int fd, const std::string & data) {
+	unsigned long long done = 0;
+	while(done < data.length()) {
+		ssize_t n = send(fd, data.data() + done, data.length() - done, MSG_NOSIGNAL);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) return false;
+		done += n;
+	}
+	return true;
+}
+
+// receives len bytes from the socket fd at the end of data; false if the peer
+// closes first, or (timeout >= 0) nothing comes for timeout milliseconds
+inline bool receiveAll(int fd, std::string & data, unsigned long long len, int timeout = -1) {
+	unsigned long long start = data.size();
+	data.resize(start + len);
+	unsigned long long got = 0;
+	while(got < len) {
+		if(timeout >= 0) {
+			struct pollfd p = {fd, POLLIN, 0};
+			int ready = poll(&p, 1, timeout);
+			if(ready < 0 && errno == EINTR) continue;
+			if(ready <= 0) break;
+		}
+		ssize_t n = recv(fd, &data[start + got], len - got, 0);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) break;
+		got += n;
+	}
+	data.resize(start + got);
+	return got == len;
+}
+
+#endif
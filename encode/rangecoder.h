@@ -0,0 +1,108 @@
+#ifndef __RANGECODER_H__
+#define __RANGECODER_H__
+#include <string>
+
+// an adaptive binary range coder (as in LZMA): each bit is coded with the
+// probability of a 0 in its context, RANGE_PROB_BITS bits wide, which moves
+// 1/32 of the way towards every bit coded with it
+#define RANGE_PROB_BITS 11
+#define RANGE_PROB_INIT (1 << (RANGE_PROB_BITS - 1))
+#define RANGE_MOVE_BITS 5
+#define RANGE_TOP (1u << 24)
+
+typedef unsigned short RangeProb;
+
+class RangeEncoder {
+  private:
+	std::string out;
+	unsigned long long low;
+	unsigned int range;
+	unsigned char cache;
+	unsigned long long cacheSize;
+
+	// writes the top byte of low, once no carry can change it
+	void shiftLow() {
+		if((unsigned int) low < 0xFF000000u || (low >> 32) != 0) {
+			unsigned char carry = low >> 32;
+			unsigned char temp = cache;
+			do {
+				out += (char) (unsigned char) (temp + carry);
+				temp = 0xFF;
+			} while(--cacheSize != 0);
+			cache = (unsigned char) (low >> 24);
+		}
+		cacheSize++;
+		low = (low & 0x00FFFFFF) << 8;
+	}
+
+  public:
+	RangeEncoder(): low(0), range(0xFFFFFFFFu), cache(0), cacheSize(1) {}
+
+	void encode(RangeProb & prob, bool bit) {
+		unsigned int bound = (range >> RANGE_PROB_BITS) * prob;
+		if(!bit) {
+			range = bound;
+			prob += ((1 << RANGE_PROB_BITS) - prob) >> RANGE_MOVE_BITS;
+		} else {
+			low += bound;
+			range -= bound;
+			prob -= prob >> RANGE_MOVE_BITS;
+		}
+		while(range < RANGE_TOP) {
+			range <<= 8;
+			shiftLow();
+		}
+	}
+
+	// the bytes coded so far, with the ones a carry can still change
+	unsigned long long size() const { return out.size() + cacheSize; }
+
+	// the coded bytes: the encoder is done after this
+	const std::string & finish() {
+		for(int i = 0; i < 5; i++) shiftLow();
+		return out;
+	}
+};
+
+class RangeDecoder {
+  private:
+	const unsigned char * data;
+	unsigned long long size;
+	unsigned long long pos;
+	unsigned int range;
+	unsigned int code;
+
+	// zeros past the end
+	unsigned char next() { return pos < size ? data[pos++] : (pos++, 0); }
+
+  public:
+	RangeDecoder(const unsigned char * data, unsigned long long size): data(data), size(size), pos(0), range(0xFFFFFFFFu), code(0) {
+		for(int i = 0; i < 5; i++) code = (code << 8) | next();
+	}
+
+	bool decode(RangeProb & prob) {
+		unsigned int bound = (range >> RANGE_PROB_BITS) * prob;
+		bool bit;
+		if(code < bound) {
+			range = bound;
+			prob += ((1 << RANGE_PROB_BITS) - prob) >> RANGE_MOVE_BITS;
+			bit = false;
+		} else {
+			code -= bound;
+			range -= bound;
+			prob -= prob >> RANGE_MOVE_BITS;
+			bit = true;
+		}
+		while(range < RANGE_TOP) {
+			range <<= 8;
+			code = (code << 8) | next();
+		}
+		return bit;
+	}
+
+	// the bytes not read yet (the decoder reads 4 bytes ahead of the bits it has
+	// decoded, and zeros past the end)
+	unsigned long long left() const { return pos < size ? size - pos : 0; }
+};
+
+#endif
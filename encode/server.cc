@@ -0,0 +1,201 @@
+#include "server.h"
+#include <omp.h>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sstream>
+#include <exception>
+
+using namespace std;
+
+// set by SIGINT and SIGTERM; the workers look at it between requests
+static volatile sig_atomic_t stopping = 0;
+
+static void stopServing(int){
+	stopping = 1;
+}
+
+// the address of the socket at path; false if path is too long for one
+static bool socketAddress(const string & path, struct sockaddr_un & address){
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(path.empty() || path.length() >= sizeof(address.sun_path)) return false;
+	strcpy(address.sun_path, path.c_str());
+	return true;
+}
+
+// waits for the next request on fd, SERVER_POLL at a time; false if the
+// connection is idle for SERVER_IDLE_TIMEOUT, fails, or the server stops
+static bool waitRequest(int fd){
+	struct pollfd p = {fd, POLLIN, 0};
+	for(int waited = 0; !stopping && waited < SERVER_IDLE_TIMEOUT; waited += SERVER_POLL){
+		int ready = poll(&p, 1, SERVER_POLL);
+		if(ready > 0) return true;
+		if(ready < 0 && errno != EINTR) return false;
+	}
+	return false;
+}
+
+
+CodecServer::CodecServer(const string & path, const Compressor & compressor, const Decompressor & decompressor, int workers):
+	path(path), compressor(compressor), decompressor(decompressor), workers(workers > 0 ? workers : omp_get_max_threads()),
+	listener(-1), started(omp_get_wtime()), connections(0), compressed(0), decompressed(0), failed(0), deadlines(0),
+	badRequests(0), bytesIn(0), bytesOut(0), busy(0), slowest(0) {
+	struct sockaddr_un address;
+	if(!socketAddress(path, address)) return;
+
+	// a socket nobody accepts on is left by a server that is gone
+	struct stat info;
+	if(lstat(path.c_str(), &info) == 0) {
+		if(!S_ISSOCK(info.st_mode)) return;
+		int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		bool inUse = probe >= 0 && connect(probe, (struct sockaddr *) &address, sizeof(address)) == 0;
+		if(probe >= 0) close(probe);
+		if(inUse) return;
+		unlink(path.c_str());
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0) return;
+	// the workers all wait on the socket, so the ones that lose an accept must not block
+	if(bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0
+		|| fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+		close(fd);
+		return;
+	}
+	listener = fd;
+}
+
+CodecServer::~CodecServer(){
+	if(listener < 0) return;
+	close(listener);
+	unlink(path.c_str());
+}
+
+void CodecServer::run(){
+	if(listener < 0) return;
+	stopping = 0;
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopServing;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	#pragma omp parallel num_threads(workers)
+	while(!stopping){
+		struct pollfd p = {listener, POLLIN, 0};
+		if(poll(&p, 1, SERVER_POLL) <= 0) continue;
+		int fd = accept(listener, NULL, NULL);
+		if(fd < 0) continue;
+		#pragma omp critical(serverStats)
+		connections++;
+		serveConnection(fd);
+		close(fd);
+	}
+}
+
+void CodecServer::serveConnection(int fd){
+	while(waitRequest(fd)){
+		string header;
+		if(!receiveAll(fd, header, SERVER_REQUEST_HEADER, SERVER_IDLE_TIMEOUT)) return;
+		double start = omp_get_wtime();
+		char command = header[0];
+		unsigned long long deadline = getNumber(header.data() + 1, 4);
+		unsigned long long len = getNumber(header.data() + 5, 8);
+
+		// the payload of a request too long is not read, so the connection is
+		// closed after the reply
+		string payload, reply;
+		int status = SERVER_BAD_REQUEST;
+		bool tooLong = len > SERVER_MAX_PAYLOAD;
+		if(!tooLong) {
+			if(!receiveAll(fd, payload, len, SERVER_IDLE_TIMEOUT)) return;
+			status = handle(command, payload, deadline ? start + deadline / 1000.0 : 0, reply);
+		}
+		double elapsed = omp_get_wtime() - start;
+
+		#pragma omp critical(serverStats)
+		{
+			bytesIn += SERVER_REQUEST_HEADER + payload.size();
+			bytesOut += SERVER_REPLY_HEADER + reply.size();
+			if(status == SERVER_FAILED) failed++;
+			else if(status == SERVER_DEADLINE) deadlines++;
+			else if(status == SERVER_BAD_REQUEST) badRequests++;
+			if(command == SERVER_COMPRESS || command == SERVER_DECOMPRESS) {
+				busy += elapsed;
+				if(elapsed > slowest) slowest = elapsed;
+			}
+		}
+
+		string frame;
+		frame += (char) status;
+		putNumber(frame, reply.size(), 8);
+		frame += reply;
+		if(!sendAll(fd, frame) || tooLong) return;
+	}
+}
+
+int CodecServer::handle(char command, const string & payload, double deadline, string & reply){
+	// a request whose payload came too late is not worked on
+	if(deadline && omp_get_wtime() > deadline) return SERVER_DEADLINE;
+
+	// the decoder checks the lengths of a payload; should a request still throw
+	// (as std::bad_alloc), it fails alone rather than ending every worker
+	if(command == SERVER_COMPRESS) {
+		if(compressor.failed()) return SERVER_FAILED;
+		try {
+			reply = compressor.compress(payload);
+		} catch(const exception &) {
+			reply = "";
+			return SERVER_FAILED;
+		}
+		#pragma omp critical(serverStats)
+		compressed++;
+	} else if(command == SERVER_DECOMPRESS) {
+		bool ok;
+		try {
+			ok = decompressor.decompress(payload, reply);
+		} catch(const exception &) {
+			ok = false;
+		}
+		if(!ok) {
+			reply = "";
+			return SERVER_FAILED;
+		}
+		#pragma omp critical(serverStats)
+		decompressed++;
+	} else if(command == SERVER_STATS) {
+		reply = statistics();
+		return SERVER_OK;
+	} else return SERVER_BAD_REQUEST;
+
+	// the client has given up on a late reply
+	if(deadline && omp_get_wtime() > deadline) {
+		reply = "";
+		return SERVER_DEADLINE;
+	}
+	return SERVER_OK;
+}
+
+string CodecServer::statistics(){
+	ostringstream out;
+	#pragma omp critical(serverStats)
+	{
+		out << "uptime " << omp_get_wtime() - started << endl;
+		out << "workers " << workers << endl;
+		out << "connections " << connections << endl;
+		out << "compress " << compressed << endl;
+		out << "decompress " << decompressed << endl;
+		out << "failed " << failed << endl;
+		out << "deadline " << deadlines << endl;
+		out << "bad_request " << badRequests << endl;
+		out << "bytes_in " << bytesIn << endl;
+		out << "bytes_out " << bytesOut << endl;
+		out << "busy " << busy << endl;
+		out << "slowest " << slowest << endl;
+	}
+	return out.str();
+}
@@ -0,0 +1,58 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+#include <string>
+#include "codec.h"
+#include "protocol.h"
+
+// The codec as a daemon: the trie is built (or its snapshot mapped) once, and
+// a pool of workers serves the requests of protocol.h on a Unix socket, each
+// worker one connection at a time, all with the same Compressor and
+// Decompressor (and so the same global cache).
+#define SERVER_SOCKET "codec.sock"
+
+// a worker drops a connection after this many milliseconds without a request
+// (or in the middle of one), so an idle client cannot hold it forever
+#define SERVER_IDLE_TIMEOUT 30000
+
+// how often (in milliseconds) a waiting worker looks whether the server is stopping
+#define SERVER_POLL 200
+
+class CodecServer {
+  private:
+	std::string path;
+	const Compressor & compressor;
+	const Decompressor & decompressor;
+	int workers;
+	int listener;
+	double started;
+	// the counters of the stats, under the critical section serverStats
+	unsigned long long connections;
+	unsigned long long compressed;
+	unsigned long long decompressed;
+	unsigned long long failed;
+	unsigned long long deadlines;
+	unsigned long long badRequests;
+	unsigned long long bytesIn;
+	unsigned long long bytesOut;
+	// the seconds spent on compress and decompress requests, and on the slowest
+	double busy;
+	double slowest;
+	// serves the requests of a connection until it closes (or the server stops)
+	void serveConnection(int fd);
+	// the status and the payload of the reply to a request; deadline is a time
+	// of omp_get_wtime (0: none)
+	int handle(char command, const std::string & payload, double deadline, std::string & reply);
+	std::string statistics();
+
+  public:
+	// listens on the socket at path (a socket left there by a server that is
+	// gone is replaced); workers <= 0 is the number of threads of OpenMP
+	CodecServer(const std::string & path, const Compressor & compressor, const Decompressor & decompressor, int workers = 0);
+	// closes the socket and removes it
+	~CodecServer();
+	bool listening() const { return listener >= 0; }
+	// serves until SIGINT or SIGTERM
+	void run();
+};
+
+#endif
@@ -0,0 +1,381 @@
+#include "stream.h"
+#include "encode.h"
+#include "decode.h"
+#include "wordclass.h"
+#include "fields.h"
+#include "chars.h"
+#include "global_cache.h"
+#include <omp.h>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+using namespace std;
+
+// adds n to data, highest byte first
+static void appendNumber(string & data, unsigned long long n){
+	for(int shift = 56; shift >= 0; shift -= 8) data += (char) (n >> shift);
+}
+
+// the number at data, highest byte first
+static unsigned long long readNumber(const char * data){
+	unsigned long long n = 0;
+	for(int i = 0; i < 8; i++) n = (n << 8) | (unsigned char) data[i];
+	return n;
+}
+
+// whether c ends a phrase (see StreamBlock); inside is whether there has been a
+// letter since the end of the phrase before
+static bool endsPhrase(char c, bool & inside){
+	if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) inside = true;
+	else if(c == '.' && inside) {
+		inside = false;
+		return true;
+	}
+	return false;
+}
+
+// checks the header of a stream of blocks: its blocks hold 1 to
+// STREAM_MAX_BLOCK_SIZE chars
+static bool streamHeader(const string & header, int & encodingChars, unsigned long long & blockSize){
+	int format;
+	return readCodecHeader(header, format, encodingChars, blockSize) && format == CODEC_BLOCKS
+		&& blockSize > 0 && blockSize <= STREAM_MAX_BLOCK_SIZE;
+}
+
+// checks the header of a block of a stream of blockSize chars blocks, in the
+// chars scheme encodingChars; len is the number of bytes after it
+static bool blockHeader(const string & header, unsigned long long blockSize, int encodingChars, unsigned long long & len){
+	int format, chars;
+	unsigned long long size;
+	// all the blocks use the chars scheme of the stream
+	if(!readCodecHeader(header, format, chars, size) || format == CODEC_BLOCKS || chars != encodingChars) return false;
+	len = (format == CODEC_GAMMA) ? size / 8 + (size % 8 != 0) : size;
+	return len <= STREAM_MAX_BLOCK(blockSize) - CODEC_HEADER_SIZE;
+}
+
+// the block of text, compressed and packed (in the gamma format if the range
+// format would pass STREAM_MAX_BLOCK)
+static string packBlock(const string & text, trie * GlobalSuffixTrie, bool rangeCoded, const EncodeOptions & options){
+	if(rangeCoded){
+		RangeFieldWriter fields;
+		compressFields(text, GlobalSuffixTrie, options, fields);
+		string packed = packRangeCoded(fields.finish(), options.encodingChars);
+		if(packed.size() <= STREAM_MAX_BLOCK(text.size())) return packed;
+	}
+	return packCompressed(bestCompression(text, GlobalSuffixTrie, options), options.encodingChars);
+}
+
+// the text of a block read from a stream of blockSize chars blocks, whose header
+// has been checked; false if it is broken
+static bool unpackBlock(const string & block, trie * GlobalSuffixTrie, const CharCodec & chars, unsigned long long blockSize,
+	string & text){
+	const unsigned char * body = (const unsigned char *) block.data() + CODEC_HEADER_SIZE;
+	unsigned long long size = readNumber(block.data() + 6);
+	if(block[4] == CODEC_RANGE) return decodeRangeCoded(body, size, GlobalSuffixTrie, blockSize, text);
+	BitReader in(body, size);
+	return decodeText(in, GlobalSuffixTrie, chars, blockSize, text);
+}
+
+
+StreamEncoder::StreamEncoder(ostream & out, trie * GlobalSuffixTrie, unsigned long long blockSize, bool rangeCoded, int threads,
+	unsigned long long blockPhrases, const EncodeOptions & options):
+	out(out), GlobalSuffixTrie(GlobalSuffixTrie), options(options),
+	blockSize(blockSize == 0 ? 1 : blockSize > STREAM_MAX_BLOCK_SIZE ? STREAM_MAX_BLOCK_SIZE : blockSize), rangeCoded(rangeCoded),
+	threads(threads > 0 ? threads : omp_get_max_threads()), blockPhrases(blockPhrases), numPhrases(0), inside(false), started(false),
+	scanned(0), scannedPhrases(0), scannedInside(false), numChars(0), numBytes(0) {
+	string header = codecHeader(CODEC_BLOCKS, options.encodingChars, this->blockSize);
+	out.write(header.data(), header.size());
+	numBytes += header.size();
+
+	// the fingerprint is found once, before the threads look it up
+	if(options.cache) GlobalSuffixTrie->fingerprint();
+}
+
+void StreamEncoder::writeBatch(){
+	int n = batch.size();
+	vector<string> packed(n);
+
+	// each block is compressed by one thread (the threads of bestCompression
+	// are only used when there is one block)
+	#pragma omp parallel for schedule(dynamic) num_threads(threads)
+	for(int i = 0; i < n; i++) packed[i] = packBlock(batch[i], GlobalSuffixTrie, rangeCoded, options);
+
+	for(int i = 0; i < n; i++){
+		batchBlocks[i].offset = numBytes;
+		index.push_back(batchBlocks[i]);
+		out.write(packed[i].data(), packed[i].size());
+		numChars += batch[i].size();
+		numBytes += packed[i].size();
+	}
+	batch.clear();
+	batchBlocks.clear();
+}
+
+void StreamEncoder::cutBlock(unsigned long long end){
+	StreamBlock block;
+	block.offset = 0;
+	block.chars = end;
+	block.firstPhrase = numPhrases;
+	block.inside = inside;
+	block.started = started;
+	for(unsigned long long i = 0; i < end; i++){
+		started = !endsPhrase(pending[i], inside);
+		if(!started) numPhrases++;
+	}
+
+	batch.push_back(pending.substr(0, end));
+	batchBlocks.push_back(block);
+	pending.erase(0, end);
+	scanned = 0;
+	scannedPhrases = 0;
+	scannedInside = inside;
+	if((int) batch.size() == threads) writeBatch();
+}
+
+void StreamEncoder::write(const char * text, unsigned long long len){
+	while(len > 0){
+		unsigned long long n = blockSize - pending.size();
+		if(n > len) n = len;
+		pending.append(text, n);
+		text += n;
+		len -= n;
+
+		// the block ends with its last phrase, if it has blockPhrases of them
+		while(blockPhrases && scanned < pending.size())
+			if(endsPhrase(pending[scanned++], scannedInside) && ++scannedPhrases == blockPhrases) cutBlock(scanned);
+
+		if(pending.size() == blockSize) cutBlock(blockEnd(pending, blockSize));
+	}
+}
+
+void StreamEncoder::finish(){
+	if(!pending.empty()) cutBlock(pending.size());
+	if(!batch.empty()) writeBatch();
+
+	string footer = STREAM_INDEX_MAGIC;
+	appendNumber(footer, index.size());
+	for(unsigned int i = 0; i < index.size(); i++){
+		appendNumber(footer, index[i].offset);
+		appendNumber(footer, index[i].chars);
+		appendNumber(footer, index[i].firstPhrase);
+		appendNumber(footer, index[i].inside | index[i].started << 1);
+	}
+	appendNumber(footer, numBytes);
+	footer += STREAM_INDEX_MAGIC;
+	out.write(footer.data(), footer.size());
+	numBytes += footer.size();
+	out.flush();
+}
+
+unsigned long long blockEnd(const string & text, unsigned long long limit){
+	if(limit > text.size()) return text.size();
+	// the char after the cut has to be there to be looked at. A cut after a '.'
+	// leaves the simplifier and the spaces in the state they start a text in, so
+	// the blocks compress as the whole text would
+	unsigned long long last = (limit < text.size()) ? limit : text.size() - 1;
+	for(unsigned long long i = last; i > 0; i--)
+		if(text[i - 1] == '.' && text[i] != '.') return i;
+	for(unsigned long long i = last; i > 0; i--)
+		if(text[i - 1] == ' ' && text[i] != ' ') return i;
+	return limit;
+}
+
+unsigned long long encodeStream(istream & in, ostream & out, trie * GlobalSuffixTrie, unsigned long long blockSize, bool rangeCoded, int threads,
+	unsigned long long blockPhrases, const EncodeOptions & options){
+	StreamEncoder encoder(out, GlobalSuffixTrie, blockSize, rangeCoded, threads, blockPhrases, options);
+	vector<char> chunk(1 << 16);
+	while(in.read(&chunk[0], chunk.size()) || in.gcount() > 0) encoder.write(&chunk[0], in.gcount());
+	encoder.finish();
+	return encoder.bytes();
+}
+
+
+StreamDecoder::StreamDecoder(int fd, trie * GlobalSuffixTrie, const HuffmanChars * huffman, int threads):
+	fd(fd), GlobalSuffixTrie(GlobalSuffixTrie), huffman(huffman), blockSize(0), encodingChars(0),
+	threads(threads > 0 ? threads : omp_get_max_threads()), broken(false), ended(false), numBlocks(0), numChars(0), given(0) {
+	string header;
+	if(!readBytes(header, CODEC_HEADER_SIZE) || !streamHeader(header, encodingChars, blockSize)) broken = true;
+	if(encodingChars == 2 && !huffman) broken = true;
+}
+
+bool StreamDecoder::readBytes(string & block, unsigned long long len){
+	unsigned long long start = block.size();
+	unsigned long long got = 0;
+	while(got < len){
+		unsigned long long chunk = min(len - got, (unsigned long long) STREAM_READ_CHUNK);
+		block.resize(start + got + chunk);
+		ssize_t n = read(fd, &block[start + got], chunk);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) break;
+		got += n;
+	}
+	block.resize(start + got);
+	return got == len;
+}
+
+bool StreamDecoder::readBlock(string & block){
+	// the header of the block, then as many bytes as it says
+	block.clear();
+	if(!readBytes(block, CODEC_HEADER_SIZE)) {
+		// the stream may only end between blocks
+		broken = !block.empty();
+		return false;
+	}
+	if(block.compare(0, 4, STREAM_INDEX_MAGIC) == 0) {
+		// the index has to count the blocks before it
+		broken = readNumber(block.data() + 4) != numBlocks;
+		return false;
+	}
+
+	unsigned long long len;
+	if(!blockHeader(block, blockSize, encodingChars, len) || !readBytes(block, len)) {
+		broken = true;
+		return false;
+	}
+	numBlocks++;
+	return true;
+}
+
+void StreamDecoder::readBatch(){
+	vector<string> blocks;
+	string block;
+	while((int) blocks.size() < threads && readBlock(block)) blocks.push_back(block);
+	if((int) blocks.size() < threads) ended = true;
+
+	int n = blocks.size();
+	texts.assign(n, "");
+	given = 0;
+	const CharCodec chars(encodingChars, huffman);
+	// one block per thread; the threads of a batch of several blocks are quiet,
+	// and a single block prints as the thread that reads the stream would
+	bool comments = COMMENT && n == 1;
+	vector<char> ok(n);
+	#pragma omp parallel for schedule(dynamic) num_threads(threads)
+	for(int i = 0; i < n; i++){
+		bool comment = COMMENT;
+		COMMENT = comments;
+		ok[i] = unpackBlock(blocks[i], GlobalSuffixTrie, chars, blockSize, texts[i]);
+		COMMENT = comment;
+	}
+	// the blocks before a broken one are given, and the stream stops there
+	for(int i = 0; i < n; i++)
+		if(!ok[i]) {
+			texts.resize(i);
+			broken = true;
+			break;
+		}
+	for(unsigned int i = 0; i < texts.size(); i++) numChars += texts[i].length();
+}
+
+bool StreamDecoder::next(string & text){
+	text = "";
+	if(given == texts.size()){
+		if(broken || ended) return false;
+		readBatch();
+		if(texts.empty()) return false;
+	}
+	text.swap(texts[given++]);
+	return true;
+}
+
+// reads len bytes of fd from offset at the end of data; false if it ends first
+static bool readAt(int fd, unsigned long long offset, unsigned long long len, string & data){
+	unsigned long long start = data.size();
+	unsigned long long got = 0;
+	while(got < len){
+		unsigned long long chunk = min(len - got, (unsigned long long) STREAM_READ_CHUNK);
+		data.resize(start + got + chunk);
+		ssize_t n = pread(fd, &data[start + got], chunk, offset + got);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) break;
+		got += n;
+	}
+	data.resize(start + got);
+	return got == len;
+}
+
+StreamIndex::StreamIndex(int fd, trie * GlobalSuffixTrie, const HuffmanChars * huffman):
+	fd(fd), GlobalSuffixTrie(GlobalSuffixTrie), huffman(huffman), blockSize(0), encodingChars(0), broken(true) {
+	string header;
+	if(!readAt(fd, 0, CODEC_HEADER_SIZE, header) || !streamHeader(header, encodingChars, blockSize)) return;
+	if(encodingChars == 2 && !huffman) return;
+
+	// the end of the stream says where the index is
+	off_t end = lseek(fd, 0, SEEK_END);
+	string data;
+	if(end < CODEC_HEADER_SIZE + 12 || !readAt(fd, end - 12, 12, data) || data.compare(8, 4, STREAM_INDEX_MAGIC) != 0) return;
+	unsigned long long start = readNumber(data.data());
+	if(start < CODEC_HEADER_SIZE || start > (unsigned long long) end - 24) return;
+
+	data.clear();
+	unsigned long long len = end - 12 - start;
+	if(!readAt(fd, start, len, data) || data.compare(0, 4, STREAM_INDEX_MAGIC) != 0) return;
+	unsigned long long count = readNumber(data.data() + 4);
+	if(count != (len - 12) / STREAM_INDEX_ENTRY || len != 12 + count * STREAM_INDEX_ENTRY) return;
+	for(unsigned long long i = 0; i < count; i++){
+		const char * entry = data.data() + 12 + i * STREAM_INDEX_ENTRY;
+		StreamBlock block;
+		block.offset = readNumber(entry);
+		block.chars = readNumber(entry + 8);
+		block.firstPhrase = readNumber(entry + 16);
+		unsigned long long state = readNumber(entry + 24);
+		block.inside = state & 1;
+		block.started = state != 0;
+		if(block.offset < CODEC_HEADER_SIZE || block.offset >= start) return;
+		index.push_back(block);
+	}
+	broken = false;
+}
+
+bool StreamIndex::readBlock(const StreamBlock & block, string & text) const {
+	string data;
+	unsigned long long len;
+	if(!readAt(fd, block.offset, CODEC_HEADER_SIZE, data) || !blockHeader(data, blockSize, encodingChars, len) || !readAt(fd, block.offset + CODEC_HEADER_SIZE, len, data)) return false;
+	return unpackBlock(data, GlobalSuffixTrie, CharCodec(encodingChars, huffman), blockSize, text);
+}
+
+bool StreamIndex::decodeRange(unsigned long long phraseBegin, unsigned long long phraseEnd, string & text) const {
+	text = "";
+	if(broken || phraseBegin >= phraseEnd || index.empty()) return !broken;
+
+	// the last block that starts no later than phraseBegin; if the phrase is
+	// going on when it starts (even with its spaces only), the block it started in
+	unsigned int first = 0;
+	while(first + 1 < index.size() && index[first + 1].firstPhrase <= phraseBegin) first++;
+	while(first > 0 && index[first].firstPhrase == phraseBegin && index[first].started) first--;
+
+	// decodes block after block, keeping the chars of the phrases until phraseEnd
+	unsigned long long phrase = index[first].firstPhrase;
+	bool inside = index[first].inside;
+	for(unsigned int b = first; b < index.size() && phrase < phraseEnd; b++){
+		string blockText;
+		if(!readBlock(index[b], blockText)) return false;
+		for(unsigned long long i = 0; i < blockText.length() && phrase < phraseEnd; i++){
+			if(phrase >= phraseBegin) text += blockText[i];
+			if(endsPhrase(blockText[i], inside)) phrase++;
+		}
+	}
+	return true;
+}
+
+// writes all of text to fd
+static bool writeAll(int fd, const string & text){
+	unsigned long long done = 0;
+	while(done < text.length()){
+		ssize_t n = write(fd, text.data() + done, text.length() - done);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) return false;
+		done += n;
+	}
+	return true;
+}
+
+bool decodeStream(int in, int out, trie * GlobalSuffixTrie, const HuffmanChars * huffman, unsigned long long * chars, int threads){
+	StreamDecoder decoder(in, GlobalSuffixTrie, huffman, threads);
+	string text;
+	while(decoder.next(text))
+		if(!writeAll(out, text)) return false;
+	if(chars) *chars = decoder.chars();
+	return !decoder.failed();
+}
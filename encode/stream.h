@@ -0,0 +1,192 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+#include <string>
+#include <iostream>
+#include <vector>
+#include "suffix_trie.h"
+#include "encode.h"
+#include "chars.h"
+
+// A stream of blocks (CODEC_BLOCKS in wordclass.h): the header, with the most
+// chars a block can hold, then each block of the text compressed on its own as
+// by packCompressed (or packRangeCoded), with its own local dictionary and its
+// own spaces and case bits, then the index of the blocks. The text is cut after
+// a '.' where it can be, so the blocks are whole phrases; the text of the stream
+// is the blocks' text in order. As no block depends on another, a batch of them
+// is encoded (or decoded) at once, one per thread; and as the index says where
+// each block is and which phrases it holds, some phrases can be decoded without
+// the blocks before them (see StreamIndex).
+#define STREAM_BLOCK_SIZE (1 << 20)
+// the most chars a block can hold: the decoder refuses a stream whose header
+// says more, so neither the blocks it reads nor STREAM_MAX_BLOCK can be huge
+#define STREAM_MAX_BLOCK_SIZE (1ULL << 30)
+// the bytes of a block read at a time: the buffer only grows with the bytes that
+// are there, not with the length a broken header says
+#define STREAM_READ_CHUNK (1 << 16)
+
+// the index: STREAM_INDEX_MAGIC, the number of blocks, then a StreamBlock for
+// each block, then where the index is, and STREAM_INDEX_MAGIC again (all numbers
+// 8 bytes, highest first; inside and started are the bits 1 and 2 of one number)
+#define STREAM_INDEX_MAGIC "CIDX"
+#define STREAM_INDEX_ENTRY 32
+
+// The phrases are the ones bestCompression splits the text into: each ends with
+// a '.' that comes after a letter of it (the other periods are simplified into
+// spaces), and holds the spaces before it. The last one ends with the text.
+struct StreamBlock {
+	// where the header of the block is in the stream
+	unsigned long long offset;
+	unsigned long long chars;
+	// the number of phrases that end before the block, whether it starts
+	// inside a phrase (after a letter of it), and whether that phrase started in
+	// a block before it (after a letter of it or not, as with its spaces)
+	unsigned long long firstPhrase;
+	bool inside;
+	bool started;
+};
+
+// reads the chars of the text in chunks, and writes the blocks as soon as a
+// batch of them is cut: the encoder never holds more than threads + 1 blocks
+class StreamEncoder {
+  private:
+	std::ostream & out;
+	trie * GlobalSuffixTrie;
+	// the options of the blocks, the same for all of them
+	const EncodeOptions options;
+	unsigned long long blockSize;
+	bool rangeCoded;
+	int threads;
+	unsigned long long blockPhrases;
+	// the chars not cut into a block yet, fewer than blockSize
+	std::string pending;
+	// the phrases that end before pending, whether it starts inside one, and
+	// whether the chars before it hold some of that one
+	unsigned long long numPhrases;
+	bool inside;
+	bool started;
+	// how much of pending has been looked at for the ends of its phrases
+	unsigned long long scanned;
+	unsigned long long scannedPhrases;
+	bool scannedInside;
+	// the blocks cut, but not encoded yet
+	std::vector<std::string> batch;
+	std::vector<StreamBlock> batchBlocks;
+	// the blocks written
+	std::vector<StreamBlock> index;
+	unsigned long long numChars;
+	unsigned long long numBytes;
+	// cuts the first end chars of pending as the next block
+	void cutBlock(unsigned long long end);
+	// compresses the blocks of batch in parallel, and writes them in order
+	void writeBatch();
+
+  public:
+	// writes the header of the stream to out; threads <= 0 is the number of
+	// threads of OpenMP, and blockSize is within 1 and STREAM_MAX_BLOCK_SIZE. A block ends after blockPhrases phrases, if not 0, so
+	// any phrase can be decoded from the block it is in, decoding at most
+	// blockPhrases phrases before it
+	StreamEncoder(std::ostream & out, trie * GlobalSuffixTrie, unsigned long long blockSize = STREAM_BLOCK_SIZE,
+		bool rangeCoded = false, int threads = 0, unsigned long long blockPhrases = 0, const EncodeOptions & options = EncodeOptions());
+	void write(const char * text, unsigned long long len);
+	void write(const std::string & text) { write(text.data(), text.length()); }
+	// writes the chars left as the last block, and the index
+	void finish();
+	unsigned long long blocks() const { return index.size(); }
+	unsigned long long chars() const { return numChars; }
+	// the bytes written to out, with the header and the index
+	unsigned long long bytes() const { return numBytes; }
+};
+
+// where the text should be cut so that the block holds at most limit chars: after
+// the last '.' followed by something else, otherwise after the last space before
+// something else, otherwise at limit
+unsigned long long blockEnd(const std::string & text, unsigned long long limit);
+
+// encodes all the text of in as a stream of blocks; returns the bytes written
+unsigned long long encodeStream(std::istream & in, std::ostream & out, trie * GlobalSuffixTrie,
+	unsigned long long blockSize = STREAM_BLOCK_SIZE, bool rangeCoded = false, int threads = 0, unsigned long long blockPhrases = 0,
+	const EncodeOptions & options = EncodeOptions());
+
+// the most bits a char of a block takes in the gamma format. A char of a word
+// group takes its code (at most an escape of HUFFMAN_MAX_BITS bits and 8 more),
+// and at most 4 bits of the code of its group, 2 of the number of groups of its
+// phrase and 2 of the runs of the case bits; a space or a period takes less.
+// A global or local group is only used when it is shorter than the chars
+#define STREAM_MAX_CHAR_BITS (HUFFMAN_MAX_BITS + 8 + 8)
+
+// the most bytes a block of blockSize chars can be compressed to, so a broken
+// size cannot make the decoder read (and hold) more. The range format has no
+// such bound: a block it would make longer is written in the gamma format
+#define STREAM_MAX_BLOCK(blockSize) (CODEC_HEADER_SIZE + (STREAM_MAX_CHAR_BITS * (blockSize) + 7) / 8 + 64)
+
+// reads a stream of blocks from a file descriptor and decodes it a batch of
+// blocks at a time: the decoder holds threads blocks and their text, however long
+// the stream is
+class StreamDecoder {
+  private:
+	int fd;
+	trie * GlobalSuffixTrie;
+	const HuffmanChars * huffman;
+	unsigned long long blockSize;
+	int encodingChars;
+	int threads;
+	bool broken;
+	bool ended;
+	unsigned long long numBlocks;
+	unsigned long long numChars;
+	// the text of the blocks decoded, and the next one to give
+	std::vector<std::string> texts;
+	unsigned int given;
+	// reads len bytes at the end of block; false if the stream ends first
+	bool readBytes(std::string & block, unsigned long long len);
+	// reads the next block; false at the index or the end of the stream
+	bool readBlock(std::string & block);
+	// reads and decodes the next batch of blocks
+	void readBatch();
+
+  public:
+	// reads the header of the stream from fd; threads <= 0 is the number of
+	// threads of OpenMP. A stream in chars scheme 2 needs the Huffman codes
+	// it was encoded with
+	StreamDecoder(int fd, trie * GlobalSuffixTrie, const HuffmanChars * huffman, int threads = 0);
+	// decodes the next block into text; false at the end of the stream, or if
+	// it is broken
+	bool next(std::string & text);
+	// whether the stream (or its header) was broken
+	bool failed() const { return broken; }
+	unsigned long long blocks() const { return numBlocks; }
+	unsigned long long chars() const { return numChars; }
+};
+
+// reads the index at the end of a stream in a file, to decode some of its
+// phrases: only the blocks they are in are read and decoded
+class StreamIndex {
+  private:
+	int fd;
+	trie * GlobalSuffixTrie;
+	const HuffmanChars * huffman;
+	unsigned long long blockSize;
+	int encodingChars;
+	std::vector<StreamBlock> index;
+	bool broken;
+	// the text of a block
+	bool readBlock(const StreamBlock & block, std::string & text) const;
+
+  public:
+	// reads the header and the index of the stream in the file fd. As the
+	// blocks are read with pread, threads can decode ranges of it at once
+	StreamIndex(int fd, trie * GlobalSuffixTrie, const HuffmanChars * huffman);
+	bool failed() const { return broken; }
+	const std::vector<StreamBlock> & blocks() const { return index; }
+	// the text of the phrases phraseBegin to phraseEnd - 1 (fewer if the text
+	// ends first); false if a block they are in is broken
+	bool decodeRange(unsigned long long phraseBegin, unsigned long long phraseEnd, std::string & text) const;
+};
+
+// decodes the stream from the file descriptor in, writing the text of each block
+// to the file descriptor out as soon as it is decoded; false if the stream is
+// broken (the text of the blocks before it has been written)
+bool decodeStream(int in, int out, trie * GlobalSuffixTrie, const HuffmanChars * huffman, unsigned long long * chars = NULL,
+	int threads = 0);
+
+#endif
@@ -1,5 +1,5 @@
 #include "wordclass.h"
-#include <map>
+#include "fields.h"
 
 #include <iostream>
 
@@ -12,15 +12,32 @@ CompressedWords::CompressedWords() {
 	usedLast = false;
         ratio = -1.0;
 	numLetters = 0;
+	index = 0;
 	prevLetter = '!';
 }
 
 // copy constructor
 CompressedWords::CompressedWords(const CompressedWords& cp):
-	words(cp.words),revealedChars(cp.revealedChars),numLetters(cp.numLetters),
-	compressedString(cp.compressedString),ratio(cp.ratio),usedLast(cp.usedLast),
+	words(cp.words),revealedChars(cp.revealedChars),numLetters(cp.numLetters),index(cp.index),
+	compressedBits(cp.compressedBits),ratio(cp.ratio),usedLast(cp.usedLast),
 	usesLocalDict(cp.usesLocalDict),encodingScheme(cp.encodingScheme), prevLetter(cp.prevLetter) {}
 
+// assignment, member by member as the copy constructor (the global cache keeps
+// its values in place)
+CompressedWords & CompressedWords::operator = (const CompressedWords& cp){
+	words = cp.words;
+	revealedChars = cp.revealedChars;
+	numLetters = cp.numLetters;
+	index = cp.index;
+	compressedBits = cp.compressedBits;
+	ratio = cp.ratio;
+	usedLast = cp.usedLast;
+	usesLocalDict = cp.usesLocalDict;
+	encodingScheme = cp.encodingScheme;
+	prevLetter = cp.prevLetter;
+	return *this;
+}
+
 // CompressedPhrase desctructor
 CompressedPhrase::~CompressedPhrase(){
         // deallocates memory for all word CompressedWords in WordsSet
@@ -32,169 +49,73 @@ CompressedPhrase::~CompressedPhrase(){
         WordsSet.clear();
 }
 
-// converts the number n to a binary string
-// by appending log n - 1 zeros and a 1 to the left of
-// n conveted to binary
-string convertToBinary(int n, bool addOne) {
-        // the result
-        string r = "";
-        while(n!=0) {
-                string add;
-                if(n % 2 == 0) add = "0";
-                else add = "1";
-                r = add + r;
-                n /= 2;
-        }
-        // the length of n converted to binary
-        int len = r.length();
-
-        // appends 1 (if addOne is true) and log n - 1 zeros to the start of r
-        if(addOne) r = "1" + r;
-        for(int i = 1; i < len; i++) { r = "0" + r;}
-
-        return r;
+// the header of the compressed file
+string codecHeader(int format, int encodingChars, unsigned long long size){
+	string result = CODEC_MAGIC;
+	result += (char) format;
+	result += (char) encodingChars;
+	for(int shift = 56; shift >= 0; shift -= 8) result += (char) (size >> shift);
+	return result;
 }
 
-// same as above, for long long
-string convertToBinaryLong(long long n, bool addOne) {
-        // the result
-        string r = "";
-        while(n!=0) {
-                string add;
-                if(n % 2 == 0) add = "0";
-                else add = "1";
-                r = add + r;
-                n /= 2;
-        }
-        // the length of n converted to binary
-        int len = r.length();
+// adds the header of the compressed file to bits, packed
+string packCompressed(const BitWriter & bits, int encodingChars){
+	return codecHeader(CODEC_GAMMA, encodingChars, bits.size()) + bits.bytes();
+}
 
-        // appends 1 (if addOne is true) and log n - 1 zeros to the start of r
-        if(addOne) r = "1" + r;
-        for(int i = 1; i < len; i++) { r = "0" + r;}
+// adds the header of the compressed file to the range coded bytes
+string packRangeCoded(const string & coded, int encodingChars){
+	return codecHeader(CODEC_RANGE, encodingChars, coded.size()) + coded;
+}
 
-        return r;
+// checks the header at the start of data: sets format to its format,
+// encodingChars to the chars scheme it was encoded with, and size to its size
+bool readCodecHeader(const string & data, int & format, int & encodingChars, unsigned long long & size){
+	if(data.size() < CODEC_HEADER_SIZE || data.compare(0, 4, CODEC_MAGIC) != 0) return false;
+	if(data[4] < CODEC_GAMMA || data[4] > CODEC_BLOCKS || data[5] < 0 || data[5] > 2) return false;
+	format = data[4];
+	size = 0;
+	for(int i = 6; i < CODEC_HEADER_SIZE; i++) size = (size << 8) | (unsigned char) data[i];
+	encodingChars = data[5];
+	return true;
 }
 
+// checks the header of a compressed file (not a stream of blocks): sets format,
+// and size to the number of bits (CODEC_GAMMA) or bytes (CODEC_RANGE) after it
+bool unpackCompressed(const string & data, int & format, int & encodingChars, unsigned long long & size){
+	if(!readCodecHeader(data, format, encodingChars, size) || format == CODEC_BLOCKS) return false;
+	unsigned long long bytes = (format == CODEC_GAMMA) ? (size + 7) / 8 : size;
+	return bytes == data.size() - CODEC_HEADER_SIZE;
+}
 
-// encodes entire binary string from in using RLE
-string rleEncode(istringstream & in){
+// encodes the bits from in using RLE: the first bit, then the length
+// of each run of equal bits
+BitWriter rleEncode(BitReader & in){
+	BitWriter result;
 	// initial bit
-        char initial = in.peek();
-        string result = (initial == '0') ? "0" : "1";
-
-	// reads bit-by-bit
-        while(in >> initial){
-                char c;
-                int count = 1;
-		// adds # of repeated bits - 1 zeros
-                while(in >> c && c == initial){
-                        count++;
-                }
-                string bin = convertToBinary(count,false);
-                result += bin;
-		in.putback(c);
-        }
+	bool initial = in.eof() || in.peek(1);
+	result.writeBit(initial);
+
+	// reads run by run, each counted a word at a time
+	while(!in.eof()) writeGamma(result, in.readRun(), false);
 	return result;
 }
 
-// decodes entire binary string from in using RLE
-string rleDecode(istringstream &in){
-	char first;
-	in >> first;
-
-	string result;
-
-	while(1){
-	        // length of number in binary, obtained by reading all 0s at the start
-        	int i = 1;
-	        char c;
-        	while(in >> c && c == '0') i++;
-
-	        // exits if no more input
-		if(in.eof()) break;	
-
-                // the number in binary
-	        stringstream num;
-		num << c;
-		i--;
-        	while(i > 0){
-                	in >> c;
-	                num << c;
-        	        i--;
-	        }
-
-        	// the desired number in binary
-	        int binary;
-        	num >> binary;
-	        // converts binary to int
-        	int factor = 1;
-	        // the result
-        	int total = 0;
-
-	        while (binary != 0) {
-        	        total += (binary % 10) * factor;
-                	binary /= 10;
-	                factor *= 2;
-        	}
-
-		// adds first total times
-		while(total > 0){
-			result += first;
-			total--;
+// decodes the bits from in using RLE, up to the last run, or until the runs
+// pass maxBits (then in fails)
+BitWriter rleDecode(FieldReader & in, unsigned long long maxBits){
+	bool first = in.flag(FIELD_RLE_FIRST);
+
+	BitWriter result;
+	while(in.flag(FIELD_RLE_MORE)){
+		// adds first as many times as the run says
+		unsigned long long run = in.number(FIELD_RLE_RUN);
+		if(run > maxBits - result.size()) {
+			in.fail();
+			break;
 		}
-		if(first == '0') first = '1';
-		else first = '0';
+		result.writeRun(first, run);
+		first = !first;
 	}
 	return result;
 }
-
-// initializes the map possibleChars to map
-// chars in order of frequencies
-void getMap(map<char,int> & possibleChars){
-	possibleChars['e'] = 1;
-        possibleChars['t'] = 2;
-        possibleChars['a'] = 3;
-        possibleChars['o'] = 4;
-        possibleChars['i'] = 5;
-        possibleChars['n'] = 6;
-        possibleChars['s'] = 7;
-        possibleChars['h'] = 8;
-        possibleChars['r'] = 9;
-        possibleChars['d'] = 10;
-        possibleChars['l'] = 11;
-        possibleChars[' '] = 12;
-        possibleChars['c'] = 13;
-        possibleChars['u'] = 14;
-        possibleChars['m'] = 15;
-        possibleChars['w'] = 16;
-        possibleChars['f'] = 17;
-        possibleChars['g'] = 18;
-        possibleChars['y'] = 19;
-        possibleChars['p'] = 20;
-        possibleChars['b'] = 21;
-        possibleChars['v'] = 22;
-        possibleChars['k'] = 23;
-        possibleChars['j'] = 24;
-        possibleChars['x'] = 25;
-        possibleChars['q'] = 26;
-        possibleChars['z'] = 27;
-        possibleChars['.'] = 28;
-}
-
-// returns c mapped to an integer
-int charToInt(char c){
-        map<char,int> possibleChars;
-	getMap(possibleChars);
-	return possibleChars[c];
-}
-
-// returns the char corresponding to n
-char intToChar (int n){
-        map<char,int> possibleChars;
-	getMap(possibleChars);
-	for( map<char,int>::iterator it = possibleChars.begin(); it!= possibleChars.end(); it++){
-		if(it->second == n) return it->first;
-	}
-	return '\0';
-}
@@ -3,20 +3,19 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include "gamma.h"
 
 
-
-// 0 = use normal encoding scheme (a = 1, b = 2, ... z = 26, ' ' = 27)
-// 1 = use frequency - encoding scheme
-extern int ENCODINGCHARS;
-
 class CompressedWords{
 
   public:
         std::string words;
         std::vector<int> revealedChars;
 	int numLetters;
-        std::string compressedString;
+	// the rank of the words in the global dictionary, or their index in the
+	// local one
+	unsigned long long index;
+        BitWriter compressedBits;
         float ratio;
 	bool usedLast;
         bool usesLocalDict;
@@ -24,6 +23,7 @@ class CompressedWords{
 	char prevLetter;
         CompressedWords();
 	CompressedWords(const CompressedWords& cp);
+	CompressedWords & operator = (const CompressedWords& cp);
 };
 
 class CompressedPhrase {
@@ -38,16 +38,34 @@ class CompressedPhrase {
 };
 
 
-std::string convertToBinary(int n,bool addOne = true);
+// the compressed file: CODEC_MAGIC, the format, the chars scheme (see
+// EncodeOptions), a size (8 bytes, highest first), then
+//   CODEC_GAMMA: the bits of the encoder packed by BitWriter::bytes (the size
+//                is the number of bits)
+//   CODEC_RANGE: their fields range coded by a RangeFieldWriter (the size is
+//                the number of bytes)
+//   CODEC_BLOCKS: a stream of compressed files, one for each block of the text
+//                 (the size is the most chars in a block, see stream.h)
+#define CODEC_MAGIC "CMPR"
+#define CODEC_GAMMA 1
+#define CODEC_RANGE 2
+#define CODEC_BLOCKS 3
+#define CODEC_HEADER_SIZE 14
+
+std::string codecHeader(int format, int encodingChars, unsigned long long size);
+
+bool readCodecHeader(const std::string & data, int & format, int & encodingChars, unsigned long long & size);
+
+std::string packCompressed(const BitWriter & bits, int encodingChars);
 
-std::string convertToBinaryLong(long long n,bool addOne = true);
+std::string packRangeCoded(const std::string & coded, int encodingChars);
 
-std::string rleEncode(std::istringstream & in);
+bool unpackCompressed(const std::string & data, int & format, int & encodingChars, unsigned long long & size);
 
-std::string rleDecode(std::istringstream &in);
+BitWriter rleEncode(BitReader & in);
 
-int charToInt(char c);
+class FieldReader;
 
-char intToChar (int n);
+BitWriter rleDecode(FieldReader & in, unsigned long long maxBits);
 
 #endif
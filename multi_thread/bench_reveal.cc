@@ -0,0 +1,88 @@
+#include "encode.h"
+#include "create_suffix.h"
+#include <omp.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+int ENCODINGCHARS = 0;
+extern bool SUMMARY;
+
+// a word group to encode, with the last letter of the group before it
+struct Group {
+	string words;
+	char lastLetter;
+};
+
+// all the groups of 1 to 3 consecutive words in the phrases of the text
+vector<Group> readGroups(const string & file) {
+	ifstream in(file.c_str());
+	vector<Group> groups;
+	vector<string> phrase;
+	string word;
+	while (true) {
+		bool more = (bool) (in >> word);
+		if (more && word != ".") {
+			phrase.push_back(word);
+			continue;
+		}
+		for (unsigned int i = 0; i < phrase.size(); i++) {
+			string group = phrase[i];
+			for (unsigned int j = i; j < phrase.size() && j < i + 3; j++) {
+				if (j > i) group += " " + phrase[j];
+				Group g;
+				g.words = group;
+				g.lastLetter = (i == 0) ? '!' : phrase[i-1][phrase[i-1].size() - 1];
+				groups.push_back(g);
+			}
+		}
+		phrase.clear();
+		if (!more) break;
+	}
+	return groups;
+}
+
+// times tryAllLetters on every group of a text (simplified like a corpus file:
+// lower case words, phrases ended by " . "), with 1 to N threads, and checks
+// that every number of threads gives the same encodings as one thread
+//   bench_reveal [text] [max threads]
+int main(int argc, char ** argv) {
+	string file = argc > 1 ? argv[1] : "input";
+	int maxThreads = argc > 2 ? atoi(argv[2]) : omp_get_num_procs();
+	SUMMARY = false;
+
+	trie * GlobalSuffixTrie = readCorpus();
+	vector<Group> groups = readGroups(file);
+	cout << groups.size() << " word groups, " << omp_get_num_procs() << " cores" << endl;
+
+	vector<string> serial;
+	double serialTime = 0;
+	for (int threads = 1; threads <= maxThreads; threads++) {
+		omp_set_num_threads(threads);
+		vector<string> result;
+		double start = omp_get_wtime();
+		for (unsigned int i = 0; i < groups.size(); i++) {
+			int normalLen = normalCompression(groups[i].words).length();
+			CompressedWords * best = tryAllLetters(groups[i].words, normalLen, GlobalSuffixTrie, groups[i].lastLetter);
+			result.push_back(best->compressedString);
+			delete best;
+		}
+		double time = omp_get_wtime() - start;
+
+		if (threads == 1) {
+			serial = result;
+			serialTime = time;
+		}
+		int different = 0;
+		for (unsigned int i = 0; i < result.size(); i++) if (result[i] != serial[i]) different++;
+		cout << threads << " threads: " << time << " s, speedup " << serialTime / time << "x, "
+			<< different << " different encodings" << endl;
+	}
+	delete GlobalSuffixTrie;
+	return 0;
+}
@@ -69,38 +69,47 @@ void printStats(){
 
 
 
-vector<int> position;
-vector<int> combination;
-vector< vector<int> > combinationList;
-vector< vector<int> > combinationLetters;
-
-// recursively adds combinations to the result, stored in combinationList
-void recursiveCombinations(int offset, int k, bool splits) {
+// recursively adds to result the combinations that extend combination with k
+// more items of position, from offset on
+void recursiveCombinations(const vector<int> & position, vector<int> & combination, unsigned int offset, int k, vector< vector<int> > & result) {
         if (k == 0) {
-		if(splits) combinationList.push_back(combination);
-		else combinationLetters.push_back(combination);
+		result.push_back(combination);
                 return;
         }
 	unsigned int end = position.size() - k;
         for (unsigned int i = offset; i <= end; ++i) {
             combination.push_back(position[i]);
-            recursiveCombinations(i+1, k-1, splits);
+            recursiveCombinations(position, combination, i+1, k-1, result);
             combination.pop_back();
         }
 }
 
-// finds all combinations of k items chosen from n items
-// and stores the result in combinationList
-void findAllCombinations(int n, int k, bool splits = true){
-
-	position.clear();
-	combination.clear();
+// returns all combinations of k items chosen from n items (numbered from 1),
+// in lexicographic order
+vector< vector<int> > findAllCombinations(int n, int k){
+	vector<int> position;
+	vector<int> combination;
+	vector< vector<int> > result;
 	for (int i = 0; i < n; ++i) { 
 		position.push_back(i+1); 
 	}
-        recursiveCombinations(0, k, splits);
+        recursiveCombinations(position, combination, 0, k, result);
+	return result;
 }
 
+// the best combination of revealed chars found by one thread: the lowest ratio,
+// and on ties the first combination (as the serial search would keep it)
+struct RevealCandidate {
+	float ratio;
+	unsigned int index;
+	string compressed;
+	vector<int> revealed;
+	RevealCandidate(): ratio(-1), index(0) {}
+	bool worseThan(float otherRatio, unsigned int otherIndex) const {
+		return ratio == -1 || otherRatio < ratio || (otherRatio == ratio && otherIndex < index);
+	}
+};
+
 
 // returns the compressed string for
 // text if the standard (char-by-char) compression scheme is used
@@ -187,21 +196,39 @@ CompressedWords * tryAllLetters(string text, int normalLen, trie * GlobalSuffixT
 	// length of text
 	int len = text.length();	
 
-	bool exitEarly = false;
-
 	// text as an array
 	const char * words = text.c_str();
 	int Bound = (len <=  MAX_NUM_REVEALED_CHARS) ? len - 1 :  MAX_NUM_REVEALED_CHARS; // MAX NUMBER OF REVEALED CHARS CONSIDERED
+
+	// text is either found with every combination of revealed chars or with none
+	// (they only change which other words match it), so revealing all of it decides
+	bool exitEarly = false;
+	if(Bound >= 1) {
+		queue <unsigned int> noneHidden;
+		if(lastLetter != '!') {
+			ostringstream tmp;
+			tmp << lastLetter << " " << text;
+			exitEarly = GlobalSuffixTrie->get_rank(tmp.str(), noneHidden, true) == -1;
+		} else exitEarly = GlobalSuffixTrie->get_rank(text, noneHidden) == -1;
+		if(exitEarly && REPORT) cout << text << " NOT FOUND in global dictionary => DONE " << endl;
+	}
 	// for every possible number of revealed chars (ranging from 1 to len)
         for(int q = 1; !exitEarly && q <= Bound; q++){
 		if(REPORT) cout << "   FINDING LETTERS ; len: " << len << ", q: " << q << endl;
-		// finds all combinations of choosing q items from len items, and stores it in
-		// combinationLetters
-		findAllCombinations(len, q, false);
+		// finds all combinations of choosing q items from len items
+		vector< vector<int> > combinationLetters = findAllCombinations(len, q);
+		int numCombinations = combinationLetters.size();
 
-		// for each combination
-#pragma omp parallel for
-		for(unsigned int ITERAT = 0; ITERAT < combinationLetters.size(); ITERAT++){
+		// the best combination for this q
+		RevealCandidate best;
+
+		// each thread keeps its own best combination, and they are merged at the end
+#pragma omp parallel
+		{
+		RevealCandidate mine;
+
+#pragma omp for schedule(dynamic, 4)
+		for(int ITERAT = 0; ITERAT < numCombinations; ITERAT++){
 			if(REPORT) cout << "     Letters: " << endl << "     ";
 
 			// positions of revealed chars in ascending order
@@ -240,15 +267,7 @@ CompressedWords * tryAllLetters(string text, int normalLen, trie * GlobalSuffixT
 			} else globalRes = GlobalSuffixTrie->get_rank(text, currentRevealedQueue);
 
 
-			// if text is not found in global dictionary, done (return bestWord, with ratio -1)
-			if(globalRes == -1) {
-				if(REPORT) cout << text << " NOT FOUND in global dictionary => DONE " << endl;
-				//combinationLetters.clear();
-				//return bestWord;
-				exitEarly = true;
-			} 
-
-			if(!exitEarly){
+			{
 				// the string storing the compressed result for this combination
 				// first stores the # of reveals
 				string rev = convertToBinary(q);
@@ -296,21 +315,35 @@ CompressedWords * tryAllLetters(string text, int normalLen, trie * GlobalSuffixT
 				if(REPORT) cout << "GLOBAL: globalRes = " << globalRes << " , globalCompressed = " << globalCompressed << endl << "  normalLen = " << normalLen 
 					<< " , globalLen = " << globalLen << " , globalRatio = " << fixed << setw(7) << setprecision(3) << globalRatio << endl;
 
-				// if the ratio for this combination is better than the best ratio so far, or 
-				// this is the first combination of revealed chars tried, stores this combination
-				// in bestWord
-				if(bestWord->ratio > globalRatio || bestWord->ratio == -1) {
-					if(REPORT) cout << "OLD RATIO: " << bestWord->ratio << " worse than new ratio: "<< globalRatio << endl;
-					bestWord->compressedString = globalCompressed;
-					bestWord->ratio = globalRatio;
-					bestWord->usesLocalDict = false;
-					bestWord->revealedChars = currentRevealed;
-					bestWord->numLetters = currentRevealed.size();
+				// if the ratio for this combination is better than the best ratio of this
+				// thread so far, or it is the first combination of this thread, stores it in mine
+				if(mine.worseThan(globalRatio, ITERAT)) {
+					mine.ratio = globalRatio;
+					mine.index = ITERAT;
+					mine.compressed = globalCompressed;
+					mine.revealed = currentRevealed;
 				} // if
 			} // if
 		} // for
 
-		combinationLetters.clear();
+		// merges the best combinations of the threads: the order only depends on
+		// (ratio, index), so the result is the same as with one thread
+#pragma omp critical
+		{
+		if(mine.ratio != -1 && best.worseThan(mine.ratio, mine.index)) best = mine;
+		}
+		} // parallel
+
+		// if the best combination for q is better than the best ratio so far, or 
+		// this is the first combination of revealed chars tried, stores it in bestWord
+		if(best.ratio != -1 && (bestWord->ratio > best.ratio || bestWord->ratio == -1)) {
+			if(REPORT) cout << "OLD RATIO: " << bestWord->ratio << " worse than new ratio: "<< best.ratio << endl;
+			bestWord->compressedString = best.compressed;
+			bestWord->ratio = best.ratio;
+			bestWord->usesLocalDict = false;
+			bestWord->revealedChars = best.revealed;
+			bestWord->numLetters = best.revealed.size();
+		} // if
 		} // for
 
 		// prints best combination
@@ -644,7 +677,7 @@ string bestCompression (string text, trie * GlobalSuffixTrie){
 			if(REPORT || SUMMARY) cout << "NUMSPLITS: " << numSplits << endl;
 
 			// creates a list of all possible combinations of numSplits chosen from the m-1 splits
-			findAllCombinations(m - 1, numSplits);
+			vector< vector<int> > combinationList = findAllCombinations(m - 1, numSplits);
 
 			// the indices of the current splits
 			int splits[numSplits];
@@ -778,8 +811,6 @@ string bestCompression (string text, trie * GlobalSuffixTrie){
 				}
 
 			} // for
-
-			combinationList.clear();
 		} // for
 
 
@@ -836,10 +867,6 @@ string bestCompression (string text, trie * GlobalSuffixTrie){
 
 		delete best;
 
-
-		combinationList.clear();
-		combinationLetters.clear();
-
 	} // while
 
 	delete localDictionary;
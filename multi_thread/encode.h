@@ -6,6 +6,8 @@
 
 std::string bestCompression (std::string text, trie * GlobalSuffixTrie);
 
-CompressedWords * tryAllLetters(std::string text, int normalLen, trie * GlobalSuffixTrie);
+std::string normalCompression(std::string text);
+
+CompressedWords * tryAllLetters(std::string text, int normalLen, trie * GlobalSuffixTrie, char lastLetter);
 
 #endif
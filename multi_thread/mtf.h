@@ -4,12 +4,37 @@
 #include "encode.h"
 #include <vector>
 #include <string>
-#include <utility>
+#include <unordered_map>
 
+// move-to-front list of words. Every insert gets the next timestamp, so the
+// index of an entry is the number of live entries with a later timestamp,
+// counted with a Fenwick tree over the timestamps; a hash map finds the
+// entries of a word. All the operations take O(log n).
 class mtf {
 	private:
-		std::vector < std::pair<std::string, CompressedWords*> > dict;
+		struct entry {
+			std::string word;
+			CompressedWords* cp;
+			bool live;
+		};
+		// the entries by timestamp, the oldest first
+		std::vector <entry> entries;
+		// Fenwick tree over entries: tree[i] counts the live entries in (i - lowbit(i), i]
+		std::vector <unsigned long long> tree;
+		unsigned long long numLive;
+		// the timestamps of the live entries of each word, the oldest first
+		std::unordered_map <std::string, std::vector <unsigned long long> > where;
+
+		void add(unsigned long long time, long long delta);
+		// the number of live entries with a timestamp up to time
+		unsigned long long prefix(unsigned long long time) const;
+		// the timestamp of the k-th oldest live entry (k from 1)
+		unsigned long long select(unsigned long long k) const;
+		// renumbers the live entries from 0 when entries is full
+		void compact();
+		void remove(unsigned long long time);
 	public:
+		mtf();
 		void insert(const std::string &word, CompressedWords * cp);
 		unsigned long long index(const std::string &word);
 		std::string word(const unsigned long long index);